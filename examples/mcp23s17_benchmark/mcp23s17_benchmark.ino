@@ -0,0 +1,149 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+Benchmark of the bus cost of the basic operations. Each operation is
+run NUM_OPS times for every SPI clock in spiClocks[], with one SPI
+transaction per call (transactions = 1) and with the Batch variant
+inside one MCP23S17Batch around the whole loop (transactions = 0, e.g.
+setPin(..., false) = setPinBatch()). Interrupt servicing is
+MCP23S17InterruptEngine::service() after an input change and one
+handleInterrupt(), i.e. one read of INTF/INTCAP and the decoding of one
+event. The input change comes from TRIGGER_PIN, which has to be wired
+to GPB0.
+
+The results are printed as CSV, one line per run:
+
+op,clock_hz,transactions,ops,us,ops_per_s,bytes_per_op
+
+bytes_per_op is counted by the host simulator or, on the target, with
+MyMCP23S17_INSTRUMENT (MyMCP23S17_config.h), otherwise it is empty.
+
+The same sketch runs on the host, see extras/host/bench/bus_bench.cpp.
+There, time is the simulated bus time plus a fixed cost per transaction
+(2 us by default), without CPU time.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Interrupts.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+#define TRIGGER_PIN 4 // wired to GPB0, toggled for serviceInterrupt
+#define NUM_OPS 1000
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+MCP23S17InterruptEngine intEngine;
+
+const unsigned long spiClocks[] = {1000000, 4000000, 8000000, 10000000};
+
+typedef void (*bench_op)(uint16_t i, bool useTransaction);
+
+struct Benchmark {
+  const char *name;
+  bench_op op;
+  bool hasBatch;  // false: the operation always uses its own transaction
+};
+
+void opSetPin(uint16_t i, bool useTransaction){ myMCP.setPin(0, A, i & 1, useTransaction); }
+void opSetPorts(uint16_t i, bool useTransaction){ myMCP.setPorts(i, i >> 8, useTransaction); }
+void opGetPort(uint16_t, bool useTransaction){ myMCP.getPort(B, useTransaction); }
+void opTogglePin(uint16_t, bool useTransaction){ myMCP.togglePin(1, A, useTransaction); }
+
+#ifdef MYMCP23S17_HOST
+void setTriggerPin(uint8_t level);  // drives GPB0 of the simulated chip, see bus_bench.cpp
+#else
+void setTriggerPin(uint8_t level){ digitalWrite(TRIGGER_PIN, level); }
+#endif
+
+void opServiceInterrupt(uint16_t i, bool){
+  setTriggerPin(i & 1);  // GPB0 changes, INTB is asserted
+  intEngine.handleInterrupt();
+  intEngine.service();
+}
+
+const Benchmark benchmarks[] = {
+  {"setPin",           opSetPin,           true},
+  {"setPorts",         opSetPorts,         true},
+  {"getPort",          opGetPort,          true},
+  {"togglePin",        opTogglePin,        true},
+  {"serviceInterrupt", opServiceInterrupt, false},
+};
+
+/* bytes sent so far, 0 if they can't be counted */
+unsigned long busBytes(){
+#if defined(MYMCP23S17_HOST)
+  return SPI.stats().bytes;
+#elif defined(MyMCP23S17_INSTRUMENT)
+  unsigned long bytes = 0;
+  for(uint8_t i=0; i<MCP23S17Instrument::getNumApis(); i++){
+    bytes += MCP23S17Instrument::getApi(i).bytes;
+  }
+  return bytes;
+#else
+  return 0;
+#endif
+}
+
+unsigned long timeOps(const Benchmark &b, bool useTransaction){
+  unsigned long start = micros();
+  for(uint16_t i=0; i<NUM_OPS; i++){
+    b.op(i, useTransaction);
+  }
+  return micros() - start;
+}
+
+void runBenchmark(const Benchmark &b, unsigned long clock, bool useTransaction){
+  myMCP.setSPIClockSpeed(clock);
+  unsigned long bytes = busBytes();
+  unsigned long us = 0;
+  if(useTransaction){
+    us = timeOps(b, true);
+  }
+  else{
+    MCP23S17Batch batch(myMCP);  // one transaction (ESP-IDF: bus acquired) around the loop
+    us = timeOps(b, false);
+  }
+  bytes = busBytes() - bytes;
+
+  Serial.print(b.name);           Serial.print(',');
+  Serial.print(clock);            Serial.print(',');
+  Serial.print(useTransaction);   Serial.print(',');
+  Serial.print(NUM_OPS);          Serial.print(',');
+  Serial.print(us);               Serial.print(',');
+  Serial.print(us ? NUM_OPS * 1000000.0 / us : 0.0, 0);
+  Serial.print(',');
+  if(bytes){
+    Serial.print((double)bytes / NUM_OPS, 2);
+  }
+  Serial.println();
+}
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setPortMode(0xFF, A);                 // port A outputs, port B inputs
+  myMCP.setInterruptOnChangePort(0xFF, B);
+  pinMode(TRIGGER_PIN, OUTPUT);
+  setTriggerPin(LOW);
+  intEngine.clearInterrupts();
+  intEngine.addDevice(&myMCP);
+
+  Serial.println("op,clock_hz,transactions,ops,us,ops_per_s,bytes_per_op");
+  for(const Benchmark &b : benchmarks){
+    for(unsigned long clock : spiClocks){
+      runBenchmark(b, clock, true);
+      if(b.hasBatch){
+        runBenchmark(b, clock, false);
+      }
+    }
+  }
+  Serial.println();
+}
+
+void loop(){}
@@ -0,0 +1,61 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to drive several MCP23S17 on one SPI bus with
+MCP23S17Bus. Four MCP23S17 share one CS line, they are distinguished
+by their hardware address (A2/A1/A0).
+
+Port writes are collected with the bus setters and written with
+flush() - all devices in one SPI transaction. scanAll() reads port
+A and B of all devices in one transaction.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Bus.h>
+#define CS_PIN 5   // Chip Select Pin, shared by all devices
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 mcp0 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 0); // A2/A1/A0 = LOW/LOW/LOW
+MyMCP23S17 mcp1 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 1); // A2/A1/A0 = LOW/LOW/HIGH
+MyMCP23S17 mcp2 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 2); // A2/A1/A0 = LOW/HIGH/LOW
+MyMCP23S17 mcp3 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 3); // A2/A1/A0 = LOW/HIGH/HIGH
+
+MCP23S17Bus bus = MCP23S17Bus(&SPI, 10000000);
+uint16_t inputs[4];
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  bus.addDevice(&mcp0);
+  bus.addDevice(&mcp1);
+  bus.addDevice(&mcp2);
+  bus.addDevice(&mcp3);
+  if(!bus.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  for(uint8_t i=0; i<bus.getNumDevices(); i++){
+    bus.getDevice(i)->setPortMode(0b11111111, A); // port A: outputs
+    bus.getDevice(i)->setPortMode(0, B, INPUT_PULLUP); // port B: inputs with pull-up
+  }
+}
+
+void loop(){
+  static uint8_t step = 0;
+  for(uint8_t i=0; i<bus.getNumDevices(); i++){
+    bus.setPort(i, 1<<((step + i) % 8), A); // running light
+  }
+  bus.flush(); // one transaction for all devices
+
+  bus.scanAll(inputs);
+  for(uint8_t i=0; i<bus.getNumDevices(); i++){
+    Serial.print(inputs[i]>>8, BIN); // port B
+    Serial.print(" ");
+  }
+  Serial.println();
+  step++;
+  delay(200);
+}
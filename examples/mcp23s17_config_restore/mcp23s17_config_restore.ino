@@ -0,0 +1,59 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to configure an MCP23S17 with one constant
+MCP23S17Config instead of a sequence of setPortMode(), setPortPullUp(),
+setInterruptOnChangePort(), ... calls. The configuration is built at
+compile time, apply() writes it in one SPI frame and reads it back
+in a second one.
+
+Once per second the sketch checks the device with capture(). If the
+configuration was lost (e.g. brown-out of the MCP23S17) it is applied
+again.
+
+After a restart of the MCU only (e.g. watchdog), adoptDeviceState()
+takes over the running device in one read frame: the outputs keep their
+levels, Init() and apply() are only needed if the device was reset too.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+
+/* port A: outputs, GPA0 high; port B: inputs with pull-ups and interrupt-on-change, INTA/INTB mirrored */
+static constexpr MCP23S17Config bootConfig = MCP23S17Config()
+  .withOutputs(0x00FF)
+  .withLevels(0x0001)
+  .withPullUps(0xFF00)
+  .withInterruptOnChange(0xFF00)
+  .withIoCon(1<<MyMCP23S17::MIRROR);
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(myMCP.adoptDeviceState() && myMCP.getConfig().ioDir == bootConfig.ioDir){
+    Serial.println("Device adopted, outputs unchanged");
+    return;
+  }
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  if(!myMCP.apply(bootConfig, true)){
+    Serial.println("Verify failed!");
+  }
+}
+
+void loop(){
+  MCP23S17Config current = myMCP.capture();
+  if(current.ioDir != bootConfig.ioDir || current.gppu != bootConfig.gppu){
+    Serial.println("Configuration lost, restoring");
+    myMCP.apply(bootConfig, true);
+  }
+  delay(1000);
+}
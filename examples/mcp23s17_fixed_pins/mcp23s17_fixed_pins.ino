@@ -0,0 +1,42 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows the compile-time front-end MCP23S17<CsPin>. CS pin,
+opcode and registers are template arguments / constants, so writing
+a fixed pin is a shadow update plus one 3 byte SPI frame.
+
+An LED is connected to GPA3, a button (to GND) to GPB0. The runtime
+API (setPinMode, setPortMode, ...) is still available.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Fixed.h>
+#define CS_PIN 5   // Chip Select Pin
+
+MCP23S17<CS_PIN> myMCP(&SPI);
+auto led = myMCP.pin<A, 3>();
+auto button = myMCP.pin<B, 0>();
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  led.setMode(OUTPUT);
+  button.setMode(INPUT_PULLUP);
+}
+
+void loop(){
+  if(!button.get()){ // pressed
+    led.toggle();
+    delay(200);
+  }
+  myMCP.setPin<A, 7>(HIGH); // without handle
+  delay(10);
+  myMCP.setPin<A, 7>(LOW);
+}
@@ -0,0 +1,59 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to watch two MCP23S17 with MCP23S17Health. Every
+200 ms one of the devices is read back (one 18 byte SPI frame) and
+compared with the values the library wrote. If a device lost its
+registers, e.g. after a brown-out, they are written again.
+
+The statistics are printed every 5 seconds. To try it, disconnect and
+reconnect the supply of one MCP23S17.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Health.h>
+#define CS_PIN 5   // Chip Select Pin, shared by both devices
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 mcp0 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 0);
+MyMCP23S17 mcp1 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 1);
+MCP23S17Health health = MCP23S17Health(200); // interval in ms, autoRecover = true
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!mcp0.Init() || !mcp1.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  mcp0.setPortMode(0xFF, A);   // port A outputs
+  mcp0.setPort(0xA5, A);
+  mcp1.setPortPullUp(0xFF, B); // port B inputs with pull-ups
+  health.addDevice(&mcp0);
+  health.addDevice(&mcp1);
+}
+
+void loop(){
+  static unsigned long lastPrint = 0;
+  if(!health.poll()){
+    Serial.println("Register check failed!");
+  }
+  if(millis() - lastPrint >= 5000){
+    lastPrint = millis();
+    const MCP23S17HealthStats &s = health.getStats();
+    Serial.print("checks: ");       Serial.print(s.checks);
+    Serial.print(", mismatches: "); Serial.print(s.mismatches);
+    Serial.print(", stuck: ");      Serial.print(s.stuckLow + s.stuckHigh);
+    Serial.print(", recovered: ");  Serial.print(s.recoveries);
+    Serial.print(", failed: ");     Serial.println(s.failedRecoveries);
+    if(s.mismatches){
+      Serial.print("last error: device "); Serial.print(s.lastErrorDevice);
+      Serial.print(", register 0x");       Serial.print(s.lastErrorReg, HEX);
+      Serial.print(", at ");               Serial.print(s.lastErrorMs);
+      Serial.println(" ms");
+    }
+  }
+}
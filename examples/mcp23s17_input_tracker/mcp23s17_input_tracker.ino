@@ -0,0 +1,53 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to react to input changes only, with
+MCP23S17InputTracker. Both ports are inputs with pull-ups, the inputs
+are active low (IPOL), so a closed switch reads 1.
+
+Every 10 ms poll() reads both ports in one SPI frame and returns the
+pins which rose / fell since the last poll. A callback is subscribed
+for the pressed edge of GPA0 and GPB7, the loop prints all changes.
+
+Wiring: switches (to GND) at GPA0...GPA7 and GPB0...GPB7.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_InputTracker.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+MCP23S17InputTracker tracker = MCP23S17InputTracker(&myMCP);
+
+void onPressed(uint8_t pin, bool level, void *arg){
+  (void)level; (void)arg;
+  Serial.print("Pressed: pin ");
+  Serial.println(pin);
+}
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setPinModes(0xFFFF, INPUT_PULLUP, 0xFFFF); // all inputs, pull-ups, active low
+  tracker.begin();
+  tracker.subscribe(0x8001, onPressed, nullptr, MCP_RISING); // GPA0 and GPB7
+}
+
+void loop(){
+  MCP23S17Changes changes = tracker.poll();
+  if(changes){
+    for(uint8_t pin : MCP23S17Pins(changes.changed())){
+      Serial.print("pin "); Serial.print(pin);
+      Serial.println(tracker.getPin(pin) ? ": closed" : ": open");
+    }
+  }
+  delay(10);
+}
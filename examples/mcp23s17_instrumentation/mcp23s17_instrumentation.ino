@@ -0,0 +1,50 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows what the functions of the library cost on the bus.
+Uncomment #define MyMCP23S17_INSTRUMENT in MyMCP23S17_config.h, then
+every public function counts its SPI frames, bytes, transactions and
+the time spent in the transfers. The table is printed every 5 seconds.
+
+Without MyMCP23S17_INSTRUMENT the sketch only prints a hint.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setPortMode(0xFF, A);                // port A outputs
+  myMCP.setInterruptOnDefValDevPin(3, B, HIGH);
+  myMCP.setPortPullUp(0xF0, B);
+}
+
+void loop(){
+  static unsigned long lastPrint = 0;
+  myMCP.togglePin(0, A);
+  myMCP.setPort(0x55, A);
+  myMCP.getPorts();
+  delay(10);
+
+  if(millis() - lastPrint >= 5000){
+    lastPrint = millis();
+#ifdef MyMCP23S17_INSTRUMENT
+    MCP23S17Instrument::dump();
+    Serial.println();
+    MCP23S17Instrument::reset();
+#else
+    Serial.println("Uncomment MyMCP23S17_INSTRUMENT in MyMCP23S17_config.h");
+#endif
+  }
+}
@@ -0,0 +1,62 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to use MCP23S17InterruptEngine. Port A and B
+are inputs with pull-ups and interrupt-on-change. INTA and INTB are
+mirrored and connected to INT_PIN.
+
+The ISR only stores a timestamp. service() in loop() reads INTF and
+INTCAP of port A and B in one SPI frame and creates one event per
+pin that caused the interrupt. Button GPB0 has its own callback, all
+events are printed from the event queue.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Interrupts.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+#define INT_PIN 17  // connected to INTA / INTB
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+MCP23S17InterruptEngine engine;
+
+void onButton(const MCP23S17Event &event, void *arg){
+  (void)arg;
+  Serial.print("Button ");
+  Serial.println(event.level ? "released" : "pressed");
+}
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setPortMode(0, A, INPUT_PULLUP);
+  myMCP.setPortMode(0, B, INPUT_PULLUP);
+  myMCP.setIntMirror(ON); // INTA and INTB are one interrupt pin
+  myMCP.setInterruptPinPol(LOW); // active low -> FALLING
+  myMCP.setInterruptOnChangePort(0b11111111, A);
+  myMCP.setInterruptOnChangePort(0b11111111, B);
+
+  engine.addDevice(&myMCP);
+  engine.onPins(0, 1<<8, onButton); // GPB0
+  engine.begin(INT_PIN, FALLING);
+}
+
+void loop(){
+  engine.service();
+
+  MCP23S17Event event;
+  while(engine.getEvent(event)){
+    Serial.print(event.timestamp);
+    Serial.print(" us: pin ");
+    Serial.print(event.pin);
+    Serial.print(" level ");
+    Serial.println(event.level);
+  }
+}
@@ -0,0 +1,63 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library (ESP32)
+
+Two FreeRTOS tasks on different cores toggle pins of the same
+MCP23S17. This requires MyMCP23S17_THREAD_SAFE, uncomment it in
+MyMCP23S17_config.h. Then the SPI frames are serialized by a bus
+lock and the bit changes in the register mirror are atomic, so no
+task overwrites the pins of the other one.
+
+MCP23S17Batch keeps the bus for a sequence of frames and releases
+it at the end of its scope. The lock statistics show how often a
+task had to wait and how long the bus was held.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#ifndef MyMCP23S17_THREAD_SAFE
+#error "Uncomment MyMCP23S17_THREAD_SAFE in MyMCP23S17_config.h"
+#endif
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+
+void blinkTask(void *arg){
+  uint8_t firstPin = (uint32_t)arg;
+  while(1){
+    for(uint8_t i=0; i<4; i++){
+      myMCP.togglePin(firstPin + i, A);
+    }
+    vTaskDelay(1);
+  }
+}
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setAllPinsAsOutput();
+  xTaskCreatePinnedToCore(blinkTask, "blink0", 2048, (void *)0, 1, nullptr, 0);
+  xTaskCreatePinnedToCore(blinkTask, "blink4", 2048, (void *)4, 1, nullptr, 1);
+}
+
+void loop(){
+  {
+    MCP23S17Batch batch(myMCP); // bus held until the end of the scope
+    myMCP.setPortBatch(0b10101010, B);
+    myMCP.setPortBatch(0b01010101, B);
+  }
+  const MCP23S17LockStats &stats = myMCP.getBusLock()->getStats();
+  Serial.print("acquisitions: ");
+  Serial.print(stats.acquisitions);
+  Serial.print(", contentions: ");
+  Serial.print(stats.contentions);
+  Serial.print(", max. hold [µs]: ");
+  Serial.println(stats.maxHoldUs);
+  delay(1000);
+}
@@ -0,0 +1,48 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows the register pairs: each register is handled as a 16
+bit value, port A in the low byte, port B in the high byte. The library
+keeps its register mirror this way, so the functions are the same for
+both IOCON.BANK layouts.
+
+With the default layout (BANK=0) a pair is one SPI frame. To use BANK=1,
+uncomment MyMCP23S17_BANK1 in src/MyMCP23S17_config.h, Init() switches
+the device. Then a pair takes one frame per port.
+
+Wiring: LEDs at GPA0...GPA7, switches (to GND) at GPB0...GPB7.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setRegPair(MCP_GPPU, 0xFF00);  // pull-ups at port B
+  myMCP.setRegPair(MCP_IODIR, 0xFF00); // port A outputs, port B inputs
+  myMCP.setRegPair(MCP_IPOL, 0xFF00);  // closed switch (LOW) reads as 1
+}
+
+void loop(){
+  uint16_t levels = myMCP.readRegPair(MCP_GPIO);
+  uint8_t switches = levels >> 8;
+  myMCP.setRegPair(MCP_GPIO, switches); // LED on for each closed switch
+
+  uint16_t pairs[MCP_GPPU + 1];
+  myMCP.readRegPairs(MCP_IODIR, MCP_GPPU, pairs);
+  Serial.print("IODIR: 0x"); Serial.print(pairs[MCP_IODIR], HEX);
+  Serial.print(", GPPU: 0x"); Serial.print(pairs[MCP_GPPU], HEX);
+  Serial.print(", switches: 0x"); Serial.println(switches, HEX);
+  delay(500);
+}
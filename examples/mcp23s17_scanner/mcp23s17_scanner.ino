@@ -0,0 +1,68 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to sample the inputs of two MCP23S17 at a fixed
+rate (here 2 kHz) with MCP23S17Scanner. On ESP32 the scans are
+triggered by an esp_timer, on other boards by poll() in loop().
+
+loop() takes a snapshot (without locking) and prints it together
+with the timing statistics once per second.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Scanner.h>
+#define CS_PIN 5   // Chip Select Pin, shared by both devices
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 mcp0 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 0);
+MyMCP23S17 mcp1 = MyMCP23S17(&SPI, CS_PIN, RESET_PIN, 1);
+MCP23S17Scanner scanner = MCP23S17Scanner(500); // period in µs
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!mcp0.Init() || !mcp1.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  mcp0.setAllPinsAsInputPullup();
+  mcp1.setAllPinsAsInputPullup();
+  scanner.addDevice(&mcp0);
+  scanner.addDevice(&mcp1);
+#ifdef ARDUINO_ARCH_ESP32
+  scanner.startTimer();
+#else
+  scanner.begin();
+#endif
+}
+
+void loop(){
+#ifndef ARDUINO_ARCH_ESP32
+  scanner.poll();
+#endif
+  static unsigned long lastPrint = 0;
+  if(millis() - lastPrint < 1000){
+    return;
+  }
+  lastPrint = millis();
+
+  MCP23S17Snapshot snapshot;
+  if(scanner.getSnapshot(snapshot)){
+    Serial.print("Scan ");
+    Serial.print(snapshot.sequence);
+    Serial.print(": ");
+    Serial.print(snapshot.ports[0], BIN);
+    Serial.print(" ");
+    Serial.println(snapshot.ports[1], BIN);
+  }
+  const MCP23S17ScanStats &stats = scanner.getStats();
+  Serial.print("avg. period [µs]: ");
+  Serial.print(stats.avgPeriodUs);
+  Serial.print(", max. jitter [µs]: ");
+  Serial.print(stats.maxJitterUs);
+  Serial.print(", overruns: ");
+  Serial.println(stats.overruns);
+}
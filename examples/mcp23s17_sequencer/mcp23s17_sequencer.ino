@@ -0,0 +1,58 @@
+/******************************************************
+
+Example sketch for the MyMCP23S17 library
+
+The sketch shows how to use MCP23S17Sequencer as a parallel output
+engine. A unipolar stepper driver (e.g. ULN2003) on GPA0...GPA3 gets
+a half step sequence, 1 step per 2 ms, repeated in a loop. On ESP32
+the steps are timed by an esp_timer and sent by the ESP-IDF driver
+if an IDF device is attached, on other boards poll() in loop() times
+them.
+
+Each step is one pre-encoded 4 byte frame to GPIOA/GPIOB.
+
+*******************************************************/
+
+#include <SPI.h>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Sequencer.h>
+#define CS_PIN 5   // Chip Select Pin
+#define RESET_PIN 99 // no reset pin, connect RESET to HIGH
+
+MyMCP23S17 myMCP = MyMCP23S17(&SPI, CS_PIN, RESET_PIN);
+MCP23S17Sequencer sequencer = MCP23S17Sequencer(&myMCP, 2000); // step period in µs
+
+static const uint16_t halfSteps[8] = {
+  0b0001, 0b0011, 0b0010, 0b0110, 0b0100, 0b1100, 0b1000, 0b1001
+};
+
+void setup(){
+  Serial.begin(115200);
+  SPI.begin();
+  if(!myMCP.Init()){
+    Serial.println("Not connected!");
+    while(1){}
+  }
+  myMCP.setAllPinsAsOutput();
+  sequencer.play(halfSteps, 8, MCP_SEQ_LOOP);
+#ifdef ARDUINO_ARCH_ESP32
+  sequencer.startTimer();
+#endif
+}
+
+void loop(){
+#ifndef ARDUINO_ARCH_ESP32
+  sequencer.poll();
+#endif
+  static unsigned long lastPrint = 0;
+  if(millis() - lastPrint > 1000){
+    lastPrint = millis();
+    const MCP23S17SeqStats &stats = sequencer.getStats();
+    Serial.print("steps: ");
+    Serial.print(stats.steps);
+    Serial.print(", late: ");
+    Serial.print(stats.lateSteps);
+    Serial.print(", max. lateness [µs]: ");
+    Serial.println(stats.maxLatenessUs);
+  }
+}
@@ -0,0 +1,128 @@
+/*****************************************
+Host (Linux) stand-in for the parts of the Arduino core used by MyMCP23S17.
+
+Together with SPI.h and MCP23S17Sim.h from this folder it allows to compile
+the unmodified library sources with a normal g++ and run them against a
+simulated MCP23S17. See README.md in this folder.
+
+The time base is simulated: millis()/micros() only advance through delay(),
+delayMicroseconds(), SPI traffic and hostAdvanceNs().
+
+*******************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+
+#define MYMCP23S17_HOST
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define F(string_literal) (string_literal)
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+/* ESP32 GPIO output set/clear registers, see MyMCP23S17_USE_ESP32_REG_WRITE */
+#ifndef BIT
+#define BIT(nr) (1UL << (nr))
+#endif
+#define GPIO_OUT_W1TS_REG  0x3FF44008
+#define GPIO_OUT_W1TC_REG  0x3FF4400C
+#define GPIO_OUT1_W1TS_REG 0x3FF44014
+#define GPIO_OUT1_W1TC_REG 0x3FF44018
+#define REG_WRITE(reg, val) hostRegWrite((reg), (val))
+/* classic ESP32: GPIO 0...39, 34...39 are input only (20, 24, 28...31 are missing there, not modelled) */
+#define GPIO_IS_VALID_OUTPUT_GPIO(gpio) ((gpio) < 34)
+
+void hostRegWrite(uint32_t reg, uint32_t val);
+
+/* Digital I/O */
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+/* External interrupts, called synchronously on the matching edge of a host pin */
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+/* Time */
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+
+/* Host extensions: pin listeners and the simulated clock */
+class HostPinListener {
+    public:
+        virtual ~HostPinListener() {}
+        virtual void pinChanged(uint8_t pin, bool level) = 0;
+};
+
+static constexpr uint8_t HOST_NUM_PINS = 64;
+
+void hostAttachPinListener(uint8_t pin, HostPinListener *listener);
+void hostDetachPinListener(uint8_t pin, HostPinListener *listener);
+bool hostPinLevel(uint8_t pin);
+uint32_t hostPinEdges(uint8_t pin);
+void hostResetPins();
+
+uint64_t hostNanos();
+void hostAdvanceNs(uint64_t ns);
+
+/* Minimal Print / Serial writing to stdout */
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c);
+        size_t write(const char *str);
+
+        size_t print(const char *str) { return write(str); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(unsigned char val, int base = DEC) { return print((unsigned long)val, base); }
+        size_t print(int val, int base = DEC) { return print((long)val, base); }
+        size_t print(unsigned int val, int base = DEC) { return print((unsigned long)val, base); }
+        size_t print(long val, int base = DEC);
+        size_t print(unsigned long val, int base = DEC);
+        size_t print(long long val, int base = DEC) { return print((long)val, base); }
+        size_t print(unsigned long long val, int base = DEC) { return print((unsigned long)val, base); }
+        size_t print(double val, int digits = 2);
+
+        size_t println() { return write("\r\n"); }
+        template <typename T> size_t println(T val) { size_t n = print(val); return n + println(); }
+        template <typename T> size_t println(T val, int base) { size_t n = print(val, base); return n + println(); }
+};
+
+class HardwareSerial : public Print {
+    public:
+        void begin(unsigned long) {}
+        void flush() { fflush(stdout); }
+        operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
@@ -0,0 +1,302 @@
+/*****************************************
+Implementation of the host stand-ins declared in Arduino.h and SPI.h.
+
+*******************************************/
+
+#include "Arduino.h"
+#include "SPI.h"
+
+HardwareSerial Serial;
+SPIClass SPI;
+
+namespace {
+
+constexpr uint8_t MAX_LISTENERS = 8;
+
+struct HostPin {
+    bool level;
+    uint8_t mode;
+    uint32_t edges;
+    HostPinListener *listeners[MAX_LISTENERS];
+    uint8_t numListeners;
+    void (*isr)(void);
+    void (*isrArg)(void *);
+    void *arg;
+    int isrMode;
+};
+
+HostPin pins[HOST_NUM_PINS];
+uint64_t nowNs = 0;
+
+void setPinLevel(uint8_t pin, bool level){
+    if(pin >= HOST_NUM_PINS){
+        return;
+    }
+    HostPin &p = pins[pin];
+    if(p.level == level){
+        return;
+    }
+    p.level = level;
+    p.edges++;
+    for(uint8_t i=0; i<p.numListeners; i++){
+        p.listeners[i]->pinChanged(pin, level);
+    }
+    if(p.isrMode == CHANGE || (p.isrMode == RISING && level) || (p.isrMode == FALLING && !level)){
+        if(p.isr){
+            p.isr();
+        }
+        if(p.isrArg){
+            p.isrArg(p.arg);
+        }
+    }
+}
+
+} // namespace
+
+/* Digital I/O */
+
+void pinMode(uint8_t pin, uint8_t mode){
+    if(pin < HOST_NUM_PINS){
+        pins[pin].mode = mode;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val){
+    setPinLevel(pin, val != LOW);
+}
+
+int digitalRead(uint8_t pin){
+    return hostPinLevel(pin) ? HIGH : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode){
+    if(pin < HOST_NUM_PINS){
+        pins[pin].isr = isr;
+        pins[pin].isrArg = nullptr;
+        pins[pin].isrMode = mode;
+    }
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode){
+    if(pin < HOST_NUM_PINS){
+        pins[pin].isr = nullptr;
+        pins[pin].isrArg = isr;
+        pins[pin].arg = arg;
+        pins[pin].isrMode = mode;
+    }
+}
+
+void detachInterrupt(uint8_t pin){
+    if(pin < HOST_NUM_PINS){
+        pins[pin].isr = nullptr;
+        pins[pin].isrArg = nullptr;
+        pins[pin].isrMode = 0;
+    }
+}
+
+void hostRegWrite(uint32_t reg, uint32_t val){
+    for(uint8_t i=0; i<32; i++){
+        if(!(val & (1UL << i))){
+            continue;
+        }
+        switch(reg){
+            case GPIO_OUT_W1TS_REG:  setPinLevel(i, true);       break;
+            case GPIO_OUT_W1TC_REG:  setPinLevel(i, false);      break;
+            case GPIO_OUT1_W1TS_REG: setPinLevel(i + 32, true);  break;
+            case GPIO_OUT1_W1TC_REG: setPinLevel(i + 32, false); break;
+            default: break;
+        }
+    }
+}
+
+void hostAttachPinListener(uint8_t pin, HostPinListener *listener){
+    if(pin >= HOST_NUM_PINS || pins[pin].numListeners >= MAX_LISTENERS){
+        return;
+    }
+    pins[pin].listeners[pins[pin].numListeners++] = listener;
+}
+
+void hostDetachPinListener(uint8_t pin, HostPinListener *listener){
+    if(pin >= HOST_NUM_PINS){
+        return;
+    }
+    HostPin &p = pins[pin];
+    for(uint8_t i=0; i<p.numListeners; i++){
+        if(p.listeners[i] == listener){
+            p.listeners[i] = p.listeners[--p.numListeners];
+            return;
+        }
+    }
+}
+
+bool hostPinLevel(uint8_t pin){
+    return (pin < HOST_NUM_PINS) ? pins[pin].level : false;
+}
+
+uint32_t hostPinEdges(uint8_t pin){
+    return (pin < HOST_NUM_PINS) ? pins[pin].edges : 0;
+}
+
+void hostResetPins(){
+    for(uint8_t i=0; i<HOST_NUM_PINS; i++){
+        pins[i].level = false;
+        pins[i].mode = INPUT;
+        pins[i].edges = 0;
+    }
+}
+
+/* Time */
+
+uint64_t hostNanos(){
+    return nowNs;
+}
+
+void hostAdvanceNs(uint64_t ns){
+    nowNs += ns;
+}
+
+void delay(unsigned long ms){
+    hostAdvanceNs((uint64_t)ms * 1000000ULL);
+}
+
+void delayMicroseconds(unsigned int us){
+    hostAdvanceNs((uint64_t)us * 1000ULL);
+}
+
+unsigned long millis(){
+    return (unsigned long)(nowNs / 1000000ULL);
+}
+
+unsigned long micros(){
+    return (unsigned long)(nowNs / 1000ULL);
+}
+
+/* Print */
+
+size_t Print::write(uint8_t c){
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t Print::write(const char *str){
+    size_t n = 0;
+    while(*str){
+        n += write((uint8_t)*str++);
+    }
+    return n;
+}
+
+size_t Print::print(unsigned long val, int base){
+    char buf[8 * sizeof(long) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if(base < 2){
+        base = DEC;
+    }
+    do {
+        unsigned long digit = val % base;
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        val /= base;
+    } while(val);
+    return write(p);
+}
+
+size_t Print::print(long val, int base){
+    if(base == DEC && val < 0){
+        return write((uint8_t)'-') + print((unsigned long)(-val), base);
+    }
+    return print((unsigned long)val, base);
+}
+
+size_t Print::print(double val, int digits){
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, val);
+    return write(buf);
+}
+
+/* SPI */
+
+void SPIClass::beginTransaction(SPISettings s){
+    if(inTransaction){
+        hostStats.nestedTransactions++;
+    }
+    inTransaction = true;
+    settings = s;
+    hostStats.transactions++;
+    hostAdvanceNs(transactionOverheadNs);
+}
+
+void SPIClass::endTransaction(){
+    inTransaction = false;
+}
+
+uint8_t SPIClass::transfer(uint8_t data){
+    uint8_t miso = 0xFF; // MISO idles high
+    bool anySelected = false;
+    for(uint8_t i=0; i<numDevices; i++){
+        if(devices[i]->spiSelected()){
+            anySelected = true;
+            miso &= devices[i]->spiTransfer(data);
+        }
+    }
+    if(!anySelected && !hwCs){
+        hostStats.strayBytes++;
+    }
+    uint64_t ns = 8000000000ULL / (settings._clock ? settings._clock : 1) + byteOverheadNs;
+    hostStats.bytes++;
+    hostStats.busyNs += ns;
+    hostAdvanceNs(ns);
+    return miso;
+}
+
+uint16_t SPIClass::transfer16(uint16_t data){
+    uint16_t hi = transfer(data >> 8);
+    uint16_t lo = transfer(data & 0xFF);
+    return (hi << 8) | lo;
+}
+
+void SPIClass::transfer(void *buf, size_t count){
+    uint8_t *b = static_cast<uint8_t *>(buf);
+    for(size_t i=0; i<count; i++){
+        b[i] = transfer(b[i]);
+    }
+}
+
+void SPIClass::transferBytes(const uint8_t *data, uint8_t *out, uint32_t size){
+    for(uint32_t i=0; i<size; i++){
+        uint8_t in = transfer(data ? data[i] : 0xFF);
+        if(out){
+            out[i] = in;
+        }
+    }
+}
+
+void SPIClass::attachDevice(HostSpiDevice *dev, uint8_t csPin){
+    if(numDevices >= MAX_DEVICES){
+        return;
+    }
+    devices[numDevices++] = dev;
+    for(uint8_t i=0; i<numCsPins; i++){
+        if(csPins[i] == csPin){
+            return;
+        }
+    }
+    csPins[numCsPins++] = csPin;
+    hostAttachPinListener(csPin, this);
+}
+
+void SPIClass::detachDevice(HostSpiDevice *dev){
+    for(uint8_t i=0; i<numDevices; i++){
+        if(devices[i] == dev){
+            devices[i] = devices[--numDevices];
+            return;
+        }
+    }
+}
+
+void SPIClass::pinChanged(uint8_t pin, bool level){
+    (void)pin;
+    hostStats.csToggles++;
+    if(!level){
+        hostStats.frames++;
+    }
+}
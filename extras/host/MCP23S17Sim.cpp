@@ -0,0 +1,268 @@
+/*****************************************
+Register-level model of an MCP23S17 for host builds, see MCP23S17Sim.h.
+
+*******************************************/
+
+#include "MCP23S17Sim.h"
+
+MCP23S17Sim::MCP23S17Sim(SPIClass *bus, uint8_t cs, uint8_t hwAddr, uint8_t rp) :
+    spi{bus}, csPin{cs}, resetPin{rp}, address{(uint8_t)(hwAddr & 0x07)}, intPinA{99}, intPinB{99}, regs{}, lastGpio{},
+    extLevels{0}, extMask{0}, selected{false}, inReset{false}, byteIndex{0}, frameIgnored{false},
+    frameRead{false}, pointer{0}, cnt{} {
+
+    powerOnReset();
+    selected = !hostPinLevel(csPin);
+    spi->attachDevice(this, csPin);
+    hostAttachPinListener(csPin, this);
+    if(resetPin < 99){
+        hostAttachPinListener(resetPin, this);
+    }
+}
+
+MCP23S17Sim::~MCP23S17Sim(){
+    spi->detachDevice(this);
+    hostDetachPinListener(csPin, this);
+    if(resetPin < 99){
+        hostDetachPinListener(resetPin, this);
+    }
+}
+
+void MCP23S17Sim::powerOnReset(){
+    for(uint8_t p=0; p<2; p++){
+        for(uint8_t r=0; r<NUM_REGS; r++){
+            regs[p][r] = 0x00;
+        }
+        regs[p][IODIR] = 0xFF;
+        lastGpio[p] = gpioValue(p);
+    }
+    byteIndex = 0;
+    pointer = 0;
+    updateIntPins();
+}
+
+void MCP23S17Sim::setReg(uint8_t port, Reg r, uint8_t val){
+    port &= 1;
+    if(r == IOCON){
+        regs[0][IOCON] = regs[1][IOCON] = val & 0xFE;
+    }
+    else if(r == GPIO){
+        regs[port][OLAT] = val;
+    }
+    else{
+        regs[port][r] = val;
+    }
+    evaluateInterrupts();
+}
+
+uint8_t MCP23S17Sim::regAt(uint8_t addr) const {
+    uint8_t port = 0;
+    Reg r = IODIR;
+    if(!decode(addr, port, r)){
+        return 0x00;
+    }
+    if(r == GPIO){
+        return gpioValue(port);
+    }
+    return regs[port][r];
+}
+
+void MCP23S17Sim::driveInputs(uint16_t levels, uint16_t mask){
+    extLevels = (extLevels & ~mask) | (levels & mask);
+    extMask |= mask;
+    evaluateInterrupts();
+}
+
+void MCP23S17Sim::releaseInputs(uint16_t mask){
+    extMask &= ~mask;
+    evaluateInterrupts();
+}
+
+uint16_t MCP23S17Sim::pinLevels() const {
+    uint16_t levels = 0;
+    for(uint8_t p=0; p<2; p++){
+        uint8_t out = ~regs[p][IODIR];
+        uint8_t ext = extLevels >> (8 * p);
+        uint8_t driven = extMask >> (8 * p);
+        uint8_t in = (ext & driven) | (regs[p][GPPU] & ~driven);
+        uint8_t level = (regs[p][OLAT] & out) | (in & ~out);
+        levels |= (uint16_t)level << (8 * p);
+    }
+    return levels;
+}
+
+uint16_t MCP23S17Sim::outputLevels() const {
+    return (regs[1][OLAT] << 8 | regs[0][OLAT]) & outputMask();
+}
+
+uint16_t MCP23S17Sim::outputMask() const {
+    return (uint16_t)(~(regs[1][IODIR] << 8 | regs[0][IODIR]));
+}
+
+bool MCP23S17Sim::intAsserted(uint8_t port) const {
+    if(regs[0][IOCON] & IOCON_MIRROR){
+        return regs[0][INTF] || regs[1][INTF];
+    }
+    return regs[port & 1][INTF];
+}
+
+bool MCP23S17Sim::intLevel(uint8_t port) const {
+    bool asserted = intAsserted(port);
+    if(regs[0][IOCON] & IOCON_ODR){
+        return !asserted;   // open drain, active low, external pull-up
+    }
+    if(regs[0][IOCON] & IOCON_INTPOL){
+        return asserted;
+    }
+    return !asserted;
+}
+
+void MCP23S17Sim::connectIntPins(uint8_t pinA, uint8_t pinB){
+    intPinA = pinA;
+    intPinB = pinB;
+    updateIntPins();
+}
+
+uint8_t MCP23S17Sim::spiTransfer(uint8_t mosi){
+    if(!selected){
+        return 0xFF;
+    }
+    cnt.frameBytes++;
+    uint8_t idx = byteIndex;
+    if(byteIndex < 2){
+        byteIndex++;
+    }
+
+    if(idx == 0){
+        /* with HAEN=0 the device address is A2 = A1 = A0 = 0, whatever the address pins are */
+        uint8_t expected = 0x40;
+        if(regs[0][IOCON] & IOCON_HAEN){
+            expected |= address << 1;
+        }
+        frameIgnored = (mosi & 0xFE) != expected;
+        frameRead = mosi & 0x01;
+        if(frameIgnored){
+            cnt.ignoredFrames++;
+        }
+        return 0xFF;
+    }
+    if(frameIgnored){
+        return 0xFF;
+    }
+    if(idx == 1){
+        pointer = mosi;
+        return 0xFF;
+    }
+
+    uint8_t miso = 0xFF;
+    if(frameRead){
+        miso = readAddr(pointer);
+        cnt.readBytes++;
+    }
+    else{
+        writeAddr(pointer, mosi);
+        cnt.writeBytes++;
+    }
+    pointer = nextAddr(pointer);
+    return miso;
+}
+
+void MCP23S17Sim::pinChanged(uint8_t pin, bool level){
+    if(pin == resetPin){
+        inReset = !level;
+        if(inReset){
+            powerOnReset();
+            cnt.resets++;
+            selected = false;
+        }
+        else{
+            selected = !hostPinLevel(csPin);
+        }
+    }
+    if(pin == csPin){
+        selected = !level && !inReset;
+        byteIndex = 0;
+        if(selected){
+            cnt.frames++;
+        }
+    }
+}
+
+bool MCP23S17Sim::decode(uint8_t addr, uint8_t &port, Reg &r) const {
+    if(bank1()){
+        port = (addr >> 4) & 1;
+        r = (Reg)(addr & 0x0F);
+        return addr < 0x20 && (addr & 0x0F) < NUM_REGS;
+    }
+    port = addr & 1;
+    r = (Reg)(addr >> 1);
+    return addr < NUM_ADDR_BANK0;
+}
+
+uint8_t MCP23S17Sim::nextAddr(uint8_t addr) const {
+    bool byteMode = regs[0][IOCON] & IOCON_SEQOP;
+    if(bank1()){
+        if(byteMode){
+            return addr;
+        }
+        if((addr & 0x0F) >= NUM_REGS - 1){
+            return (addr & 0x10) ? 0x00 : 0x10;
+        }
+        return addr + 1;
+    }
+    if(byteMode){
+        return addr ^ 0x01;
+    }
+    return (addr + 1 >= NUM_ADDR_BANK0) ? 0 : addr + 1;
+}
+
+uint8_t MCP23S17Sim::readAddr(uint8_t addr){
+    uint8_t port = 0;
+    Reg r = IODIR;
+    if(!decode(addr, port, r)){
+        return 0x00;
+    }
+    uint8_t val = (r == GPIO) ? gpioValue(port) : regs[port][r];
+    if(r == GPIO || r == INTCAP){
+        regs[port][INTF] = 0;
+        evaluateInterrupts();
+    }
+    return val;
+}
+
+void MCP23S17Sim::writeAddr(uint8_t addr, uint8_t val){
+    uint8_t port = 0;
+    Reg r = IODIR;
+    if(!decode(addr, port, r) || r == INTF || r == INTCAP){
+        return;
+    }
+    setReg(port, r, val);
+}
+
+uint8_t MCP23S17Sim::gpioValue(uint8_t port) const {
+    uint8_t level = pinLevels() >> (8 * port);
+    return level ^ (regs[port][IPOL] & regs[port][IODIR]);
+}
+
+void MCP23S17Sim::evaluateInterrupts(){
+    for(uint8_t p=0; p<2; p++){
+        uint8_t cur = gpioValue(p);
+        uint8_t onChange = ~regs[p][INTCON] & (cur ^ lastGpio[p]);
+        uint8_t onDefVal = regs[p][INTCON] & (cur ^ regs[p][DEFVAL]);
+        uint8_t cause = (onChange | onDefVal) & regs[p][GPINTEN];
+        lastGpio[p] = cur;
+        if(cause && !regs[p][INTF]){
+            regs[p][INTF] = cause;
+            regs[p][INTCAP] = cur;
+        }
+    }
+    updateIntPins();
+}
+
+void MCP23S17Sim::updateIntPins(){
+    if(intPinA < 99){
+        digitalWrite(intPinA, intLevel(0) ? HIGH : LOW);
+    }
+    if(intPinB < 99){
+        digitalWrite(intPinB, intLevel(1) ? HIGH : LOW);
+    }
+}
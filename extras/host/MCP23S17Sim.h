@@ -0,0 +1,122 @@
+/*****************************************
+Register-level model of an MCP23S17 for host builds.
+
+The model is attached to a (host) SPIClass and watches its CS pin (and
+optionally its reset pin) through the host GPIO layer, so the library
+drives it exactly as it would drive the real chip. Implemented:
+
+- all 22 registers in both IOCON.BANK layouts
+- IOCON.SEQOP (sequential / byte mode incl. the A/B toggle in BANK=0)
+- IOCON.HAEN hardware address matching of the opcode, with HAEN=0 only
+  address 0 is answered
+- IPOL, pull-ups and externally driven input levels
+- interrupt-on-change vs. previous value or DEFVAL, INTF/INTCAP latching
+  and clearing by reading GPIO or INTCAP, INTPOL/ODR/MIRROR of INTA/INTB
+- hardware reset through the reset pin
+- optionally INTA/INTB driven onto host pins (connectIntPins())
+
+Like on the real chip, INTF and INTCAP are frozen while an interrupt of a
+port is pending; further changes on that port are not latched.
+
+*******************************************/
+
+#pragma once
+
+#include "Arduino.h"
+#include "SPI.h"
+
+class MCP23S17Sim : public HostSpiDevice, private HostPinListener {
+
+    public:
+
+        /* register index within a port, the order of the BANK=1 layout */
+        enum Reg : uint8_t {IODIR, IPOL, GPINTEN, DEFVAL, INTCON, IOCON, GPPU, INTF, INTCAP, GPIO, OLAT, NUM_REGS};
+
+        static constexpr uint8_t NUM_ADDR_BANK0 = 2 * NUM_REGS;
+
+        static constexpr uint8_t IOCON_BANK   = 0x80;
+        static constexpr uint8_t IOCON_MIRROR = 0x40;
+        static constexpr uint8_t IOCON_SEQOP  = 0x20;
+        static constexpr uint8_t IOCON_DISSLW = 0x10;
+        static constexpr uint8_t IOCON_HAEN   = 0x08;
+        static constexpr uint8_t IOCON_ODR    = 0x04;
+        static constexpr uint8_t IOCON_INTPOL = 0x02;
+
+        struct Counters {
+            uint32_t frames;       // CS low phases
+            uint32_t frameBytes;   // bytes clocked while selected
+            uint32_t readBytes;    // register bytes read
+            uint32_t writeBytes;   // register bytes written
+            uint32_t ignoredFrames;// frames with a foreign opcode / address
+            uint32_t resets;       // hardware resets
+        };
+
+        MCP23S17Sim(SPIClass *bus, uint8_t csPin, uint8_t hwAddress = 0, uint8_t resetPin = 99);
+        ~MCP23S17Sim();
+
+        void powerOnReset();
+
+        /* register access bypassing SPI, addressed by port (0 = A, 1 = B) and Reg */
+        uint8_t reg(uint8_t port, Reg r) const { return regs[port & 1][r]; }
+        void setReg(uint8_t port, Reg r, uint8_t val);
+        /* register access by SPI address in the current BANK layout */
+        uint8_t regAt(uint8_t addr) const;
+
+        /* external pin levels, bit 0..7 = GPA0..7, bit 8..15 = GPB0..7; only
+           pins in mask are driven, undriven inputs read their pull-up */
+        void driveInputs(uint16_t levels, uint16_t mask = 0xFFFF);
+        void releaseInputs(uint16_t mask = 0xFFFF);
+        /* levels at the pins (outputs driven by OLAT, inputs as seen outside) */
+        uint16_t pinLevels() const;
+        /* levels driven by the chip, only meaningful for bits in outputMask() */
+        uint16_t outputLevels() const;
+        uint16_t outputMask() const;
+
+        /* INTA/INTB as logical "asserted" and as electrical level */
+        bool intAsserted(uint8_t port) const;
+        bool intLevel(uint8_t port) const;
+        /* drives intLevel() of INTA/INTB onto host pins (99 = not connected) */
+        void connectIntPins(uint8_t pinA, uint8_t pinB = 99);
+
+        uint8_t hwAddress() const { return address; }
+        const Counters &counters() const { return cnt; }
+        void resetCounters() { cnt = Counters{}; }
+
+        /* HostSpiDevice */
+        bool spiSelected() const override { return selected; }
+        uint8_t spiTransfer(uint8_t mosi) override;
+
+    private:
+
+        void pinChanged(uint8_t pin, bool level) override;
+
+        bool bank1() const { return regs[0][IOCON] & IOCON_BANK; }
+        bool decode(uint8_t addr, uint8_t &port, Reg &r) const;
+        uint8_t nextAddr(uint8_t addr) const;
+        uint8_t readAddr(uint8_t addr);
+        void writeAddr(uint8_t addr, uint8_t val);
+        uint8_t gpioValue(uint8_t port) const;
+        void evaluateInterrupts();
+        void updateIntPins();
+
+        SPIClass *spi;
+        const uint8_t csPin;
+        const uint8_t resetPin;
+        const uint8_t address;
+        uint8_t intPinA;
+        uint8_t intPinB;
+
+        uint8_t regs[2][NUM_REGS];
+        uint8_t lastGpio[2];
+        uint16_t extLevels;
+        uint16_t extMask;
+
+        bool selected;
+        bool inReset;
+        uint8_t byteIndex;
+        bool frameIgnored;
+        bool frameRead;
+        uint8_t pointer;
+
+        Counters cnt;
+};
@@ -0,0 +1,106 @@
+/*****************************************
+Host (Linux) stand-in for the Arduino SPI library.
+
+SPIClass forwards every byte to the simulated devices attached to it (see
+MCP23S17Sim.h). Devices decide on their own, by watching their CS pin,
+whether they take part in a transfer. Bytes, transactions and CS edges are
+counted in SPIStats, and every byte advances the simulated clock according
+to the clock speed of the current SPISettings.
+
+*******************************************/
+
+#pragma once
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+#define SPI_LSBFIRST 0
+#define SPI_MSBFIRST 1
+#define LSBFIRST SPI_LSBFIRST
+#define MSBFIRST SPI_MSBFIRST
+
+class SPISettings {
+    public:
+        constexpr SPISettings() : _clock{1000000}, _bitOrder{MSBFIRST}, _dataMode{SPI_MODE0} {}
+        constexpr SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) :
+            _clock{clock}, _bitOrder{bitOrder}, _dataMode{dataMode} {}
+
+        uint32_t _clock;
+        uint8_t _bitOrder;
+        uint8_t _dataMode;
+};
+
+class HostSpiDevice {
+    public:
+        virtual ~HostSpiDevice() {}
+        /* called for every byte on the bus, returns the MISO byte if selected */
+        virtual bool spiSelected() const = 0;
+        virtual uint8_t spiTransfer(uint8_t mosi) = 0;
+};
+
+struct SPIStats {
+    uint32_t bytes;           // bytes clocked on the bus
+    uint32_t transactions;    // beginTransaction() calls
+    uint32_t csToggles;       // CS edges (low and high) of attached devices
+    uint32_t frames;          // CS low phases of attached devices
+    uint32_t strayBytes;      // bytes clocked with no device selected
+    uint32_t nestedTransactions; // beginTransaction() inside a transaction
+    uint64_t busyNs;          // simulated time spent clocking bytes
+};
+
+class SPIClass : private HostPinListener {
+    public:
+        static constexpr uint8_t MAX_DEVICES = 16;
+
+        constexpr SPIClass() : devices{}, numDevices{0}, csPins{}, numCsPins{0}, settings{}, inTransaction{false}, hwCs{false},
+                     transactionOverheadNs{0}, byteOverheadNs{0}, hostStats{} {}
+
+        void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+            (void)sck; (void)miso; (void)mosi; (void)ss;
+        }
+        void end() {}
+        void setHwCs(bool use) { hwCs = use; }
+
+        void beginTransaction(SPISettings s);
+        void endTransaction();
+
+        uint8_t transfer(uint8_t data);
+        uint16_t transfer16(uint16_t data);
+        void transfer(void *buf, size_t count);
+        void transferBytes(const uint8_t *data, uint8_t *out, uint32_t size);
+        void writeBytes(const uint8_t *data, uint32_t size) { transferBytes(data, nullptr, size); }
+
+        /* Host extensions */
+        /* csPin is watched to count frames, several devices may share it */
+        void attachDevice(HostSpiDevice *dev, uint8_t csPin);
+        void detachDevice(HostSpiDevice *dev);
+        const SPIStats &stats() const { return hostStats; }
+        void resetStats() { hostStats = SPIStats{}; }
+        bool isInTransaction() const { return inTransaction; }
+        uint32_t clock() const { return settings._clock; }
+        /* fixed cost added per beginTransaction() and per byte, e.g. driver overhead */
+        void setHostOverheadNs(uint32_t perTransaction, uint32_t perByte) {
+            transactionOverheadNs = perTransaction;
+            byteOverheadNs = perByte;
+        }
+
+    private:
+        void pinChanged(uint8_t pin, bool level) override;
+
+        HostSpiDevice *devices[MAX_DEVICES];
+        uint8_t numDevices;
+        uint8_t csPins[MAX_DEVICES];
+        uint8_t numCsPins;
+        SPISettings settings;
+        bool inTransaction;
+        bool hwCs;
+        uint32_t transactionOverheadNs;
+        uint32_t byteOverheadNs;
+        SPIStats hostStats;
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,34 @@
+/*****************************************
+Runs the sketch examples/mcp23s17_benchmark on the host simulator and
+writes its CSV to stdout. The times are simulated bus times.
+
+g++ -std=c++17 -O2 -I extras/host -I src extras/host/[A-Z]*.cpp src/[A-Z]*.cpp \
+    extras/host/bench/bus_bench.cpp -o bus_bench
+./bus_bench [ns per transaction] > bench.csv
+
+The optional argument is the fixed cost of every beginTransaction() /
+endTransaction() pair (bus lock and applying the SPISettings), which
+makes the difference between transactions on and off. The default of
+2 us is in the range of Arduino-ESP32 on a 240 MHz core; 0 leaves the
+pure bus time.
+
+*******************************************/
+
+#include <MyMCP23S17.h>
+#include "MCP23S17Sim.h"
+
+static MCP23S17Sim chip(&SPI, 5);   // CS_PIN of the sketch
+static constexpr uint32_t DEFAULT_TRANSACTION_NS = 2000;
+
+/* TRIGGER_PIN of the sketch, wired to GPB0 */
+void setTriggerPin(uint8_t level){
+    chip.driveInputs(level ? 0x0100 : 0x0000, 0x0100);
+}
+
+#include "../../../examples/mcp23s17_benchmark/mcp23s17_benchmark.ino"
+
+int main(int argc, char **argv){
+    SPI.setHostOverheadNs(argc > 1 ? atoi(argv[1]) : DEFAULT_TRANSACTION_NS, 0);
+    setup();
+    return 0;
+}
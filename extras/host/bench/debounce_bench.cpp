@@ -0,0 +1,117 @@
+/*****************************************
+CPU cost of MCP23S17Debouncer on the host, compared with a per-pin
+counter loop doing the same filtering. Before the timing both are fed
+the same samples and their states and toggles are compared on every
+sample; the program exits with 1 if they ever differ.
+
+g++ -std=c++17 -O2 -I extras/host -I src extras/host/[A-Z]*.cpp src/[A-Z]*.cpp \
+    extras/host/bench/debounce_bench.cpp -o debounce_bench
+
+*******************************************/
+
+#include <chrono>
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Debounce.h>
+#include "MCP23S17Sim.h"
+
+static constexpr uint32_t NUM_SAMPLES = 10000000;
+
+/* reference: one counter per pin */
+struct PerPinDebouncer {
+    uint16_t state = 0;
+    uint8_t count[16] = {};
+    uint8_t samples = MCP23S17Debouncer::DEFAULT_SAMPLES;
+
+    uint16_t update(uint16_t sample){
+        uint16_t toggle = 0;
+        for(uint8_t i=0; i<16; i++){
+            if(((sample ^ state) >> i) & 1){
+                if(++count[i] >= samples){
+                    toggle |= 1 << i;
+                    count[i] = 0;
+                }
+            }
+            else{
+                count[i] = 0;
+            }
+        }
+        state ^= toggle;
+        return toggle;
+    }
+};
+
+/* noisy inputs: every pin toggles now and then, with bursts of bounces */
+static uint16_t nextSample(uint32_t &rnd, uint16_t level){
+    rnd = rnd * 1664525UL + 1013904223UL;
+    if((rnd >> 24) < 4){
+        level ^= 1 << ((rnd >> 8) & 0x0F);
+    }
+    uint16_t noise = (rnd >> 16) & (rnd >> 4) & (rnd >> 12);
+    return level ^ noise;
+}
+
+/* index of the first sample where the two differ, NUM_SAMPLES if they never do */
+static uint32_t compare(MCP23S17Debouncer &vertical, PerPinDebouncer &perPin){
+    uint32_t rnd = 1;
+    uint16_t level = 0;
+    for(uint32_t i=0; i<NUM_SAMPLES; i++){
+        uint16_t sample = nextSample(rnd, level);
+        level = sample;
+        uint16_t toggleVertical = vertical.update(sample);
+        uint16_t togglePerPin = perPin.update(sample);
+        if(toggleVertical != togglePerPin || vertical.getState() != perPin.state){
+            return i;
+        }
+    }
+    return NUM_SAMPLES;
+}
+
+template <typename D>
+static double measure(D &d, uint32_t &checksum){
+    uint32_t rnd = 1;
+    uint16_t level = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(uint32_t i=0; i<NUM_SAMPLES; i++){
+        uint16_t sample = nextSample(rnd, level);
+        level = sample;
+        checksum += d.update(sample);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / NUM_SAMPLES;
+}
+
+int main(){
+    MCP23S17Debouncer checkedVertical;
+    checkedVertical.begin(0);
+    PerPinDebouncer checkedPerPin;
+    uint32_t firstDiff = compare(checkedVertical, checkedPerPin);
+    if(firstDiff < NUM_SAMPLES){
+        printf("MISMATCH at sample %lu: vertical state %04X, per-pin state %04X\n", (unsigned long)firstDiff,
+               checkedVertical.getState(), checkedPerPin.state);
+        return 1;
+    }
+
+    uint32_t checksum = 0;
+    MCP23S17Debouncer vertical;
+    vertical.begin(0);
+    PerPinDebouncer perPin;
+
+    double nsVertical = measure(vertical, checksum);
+    double nsPerPin = measure(perPin, checksum);
+
+    /* one poll() on the simulated bus */
+    MCP23S17Sim chip(&SPI, 5);
+    MyMCP23S17 myMCP(&SPI, 5);
+    myMCP.Init();
+    MCP23S17Debouncer polled(&myMCP);
+    uint64_t t0 = hostNanos();
+    polled.poll();
+    uint64_t busNs = hostNanos() - t0;
+
+    printf("vertical counter: %6.2f ns/sample\n", nsVertical);
+    printf("per-pin counters: %6.2f ns/sample\n", nsPerPin);
+    printf("poll() at %lu Hz SPI: %llu ns on the bus (simulated)\n",
+           (unsigned long)MyMCP23S17::SPI_CLOCKSPEED, (unsigned long long)busNs);
+    printf("(checksum %lu)\n", (unsigned long)checksum);
+    return 0;
+}
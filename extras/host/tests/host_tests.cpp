@@ -0,0 +1,640 @@
+/*****************************************
+Host tests: SPI frames and bytes per call and the register state of the
+simulated chip after it. Exits with the number of failed checks, so a
+change of the bus traffic fails the CI job.
+
+g++ -std=c++17 -Wall -I extras/host -I src extras/host/[A-Z]*.cpp src/[A-Z]*.cpp \
+    extras/host/tests/host_tests.cpp -o host_tests && ./host_tests
+
+Build it once more with -DMyMCP23S17_BANK1 for the IOCON.BANK=1 layout, the
+expectations follow the layout: there a register pair is one frame per
+port (PAIR_FRAMES / PAIR_BYTES below).
+
+*******************************************/
+
+#include <MyMCP23S17.h>
+#include <MyMCP23S17_Bus.h>
+#include <MyMCP23S17_Health.h>
+#include <MyMCP23S17_Fixed.h>
+#include <MyMCP23S17_Interrupts.h>
+#include <MyMCP23S17_InputTracker.h>
+#include <MyMCP23S17_Scanner.h>
+#ifndef MyMCP23S17_BANK1
+#include <MyMCP23S17_Sequencer.h>
+#endif
+#include "MCP23S17Sim.h"
+
+typedef MCP23S17Sim S;
+
+#ifdef MyMCP23S17_BANK1
+static constexpr bool BANK1 = true;
+#else
+static constexpr bool BANK1 = false;
+#endif
+/* a write / read of both ports of a pair */
+static constexpr uint32_t PAIR_FRAMES = BANK1 ? 2 : 1;
+static constexpr uint32_t PAIR_BYTES = BANK1 ? 2 * 3 : 4;
+/* IOCON after Init() without hardware address */
+static constexpr uint8_t IOCON_INIT = BANK1 ? S::IOCON_BANK : 0x00;
+
+static unsigned failures = 0;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static void check(bool ok, const char *what, int line){
+    if(!ok){
+        printf("FAIL line %d: %s\n", line, what);
+        failures++;
+    }
+}
+
+/* frames and bytes on the bus since the last call */
+static void expectBus(const char *op, uint32_t frames, uint32_t bytes, int line){
+    const SPIStats &s = SPI.stats();
+    if(s.frames != frames || s.bytes != bytes || s.strayBytes != 0 || s.nestedTransactions != 0){
+        printf("FAIL line %d: %s: %u frames / %u bytes, expected %u / %u\n",
+               line, op, (unsigned)s.frames, (unsigned)s.bytes, (unsigned)frames, (unsigned)bytes);
+        failures++;
+    }
+    SPI.resetStats();
+}
+
+#define EXPECT_BUS(call, frames, bytes) do{ call; expectBus(#call, frames, bytes, __LINE__); }while(0)
+
+static void testInit(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    chip.setReg(0, S::OLAT, 0x55);
+    SPI.resetStats();
+    if(BANK1){
+        /* BANK=1 selected (2 frames), DEFVALA...OLATA, then the image from DEFVALB, read back */
+        EXPECT_BUS(CHECK(mcp.Init()), 5, 2 * 3 + (2 + 8) + 2 * (2 + 22));
+    }
+    else{
+        EXPECT_BUS(CHECK(mcp.Init()), 2, 2 * (2 + 22));  // register image, read back
+    }
+    CHECK(chip.reg(0, S::IODIR) == 0xFF && chip.reg(1, S::IODIR) == 0xFF);
+    CHECK(chip.reg(0, S::OLAT) == 0x00 && chip.reg(0, S::IOCON) == IOCON_INIT);
+    CHECK(!mcp.hasPendingWrites());
+
+    /* restart of the MCU only: Init() again, the device is still in the layout of the build */
+    MyMCP23S17 restarted(&SPI, 5);
+    CHECK(restarted.Init());
+    CHECK(chip.reg(0, S::IOCON) == IOCON_INIT && chip.reg(0, S::IODIR) == 0xFF);
+
+    MyMCP23S17 inputOnlyCs(&SPI, 35);  // GPIO 34...39 can't drive CS
+    CHECK(!inputOnlyCs.Init());
+}
+
+static void testOutputs(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    SPI.resetStats();
+
+    EXPECT_BUS(mcp.setAllPinsAsOutput(), 4, 4 * 3);  // IODIR and GPPU per port
+    CHECK(chip.reg(0, S::IODIR) == 0x00 && chip.reg(1, S::IODIR) == 0x00);
+
+    EXPECT_BUS(mcp.setPin(3, A, HIGH), 1, 3);
+    CHECK(chip.reg(0, S::OLAT) == 0x08);
+    EXPECT_BUS(mcp.togglePin(3, A), 1, 3);
+    CHECK(chip.reg(0, S::OLAT) == 0x00);
+    EXPECT_BUS(mcp.setPort(0xA5, B), 1, 3);
+    CHECK(chip.reg(1, S::OLAT) == 0xA5);
+    EXPECT_BUS(mcp.setPorts(0x12, 0x34), PAIR_FRAMES, PAIR_BYTES);
+    CHECK(chip.reg(0, S::OLAT) == 0x12 && chip.reg(1, S::OLAT) == 0x34);
+    CHECK(chip.outputLevels() == 0x3412);
+
+    EXPECT_BUS(mcp.writePins(0x0101, 0x0100), PAIR_FRAMES, PAIR_BYTES);
+    CHECK(chip.reg(0, S::OLAT) == 0x12 && chip.reg(1, S::OLAT) == 0x35);
+    EXPECT_BUS(mcp.writePins(0x00F0, 0x00F0), 1, 3);
+    CHECK(chip.reg(0, S::OLAT) == 0xF2);
+    EXPECT_BUS(mcp.togglePins(0x8001), PAIR_FRAMES, PAIR_BYTES);
+    CHECK(chip.reg(0, S::OLAT) == 0xF3 && chip.reg(1, S::OLAT) == 0xB5);
+
+    /* one transaction around the batch, no transaction per frame */
+    mcp.startBatch();
+    mcp.setPinBatch(0, A, LOW);
+    mcp.setPortBatch(0x00, B);
+    mcp.endBatch();
+    CHECK(SPI.stats().transactions == 1);
+    EXPECT_BUS((void)0, 2, 2 * 3);
+    CHECK(chip.reg(0, S::OLAT) == 0xF2 && chip.reg(1, S::OLAT) == 0x00);
+}
+
+static void testInputs(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    SPI.resetStats();
+
+    EXPECT_BUS(mcp.setPortMode(0, A, INPUT_PULLUP), 2, 2 * 3);
+    CHECK(chip.reg(0, S::GPPU) == 0xFF && chip.reg(0, S::IODIR) == 0xFF);
+    EXPECT_BUS(mcp.setPinModes(0x0300, OUTPUT), 1, 3);  // port B only, pull-ups unchanged
+    CHECK(chip.reg(1, S::IODIR) == 0xFC && chip.reg(0, S::GPPU) == 0xFF);
+    EXPECT_BUS(mcp.setPinModes(0x0101, INPUT_PULLUP), 2 * PAIR_FRAMES, 2 * PAIR_BYTES);  // GPPU, then IODIR
+    CHECK(chip.reg(0, S::GPPU) == 0xFF && chip.reg(1, S::GPPU) == 0x01 && chip.reg(1, S::IODIR) == 0xFD);
+    EXPECT_BUS(mcp.setPinModes(0x0003, OUTPUT), 2, 2 * 3);  // pull-ups of GPA0/1 off
+    CHECK(chip.reg(0, S::GPPU) == 0xFC && chip.reg(0, S::IODIR) == 0xFC);
+
+    chip.driveInputs(0x00A0, 0x00FF);
+    uint8_t port = 0;
+    EXPECT_BUS(port = mcp.getPort(A), 1, 3);
+    CHECK(port == 0xA0);
+    bool pin = false;
+    EXPECT_BUS(pin = mcp.getPin(5, A), 1, 3);
+    CHECK(pin);
+    uint16_t ports = 0;
+    EXPECT_BUS(ports = mcp.getPorts(), PAIR_FRAMES, PAIR_BYTES);
+    CHECK((ports & 0x00FF) == 0xA0);
+
+    EXPECT_BUS(mcp.setPortPolarity(0xFF, A), 1, 3);
+    CHECK(chip.reg(0, S::IPOL) == 0xFF);
+    EXPECT_BUS(port = mcp.getPort(A), 1, 3);
+    CHECK(port == 0x5C);  // GPA0/1 are outputs now, IPOL applies to inputs only
+}
+
+static void testInterrupts(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    chip.driveInputs(0x0000);
+    SPI.resetStats();
+
+    mcp.setInterruptOnChangePort(0x0F, B);
+    CHECK(chip.reg(1, S::GPINTEN) == 0x0F && chip.reg(1, S::INTCON) == 0x00);
+    SPI.resetStats();
+    chip.driveInputs(0x0200);
+    CHECK(chip.intAsserted(1));
+    uint8_t flags = 0;
+    EXPECT_BUS(flags = mcp.getIntFlag(B), 1, 3);
+    CHECK(flags == 0x02);
+    uint8_t cap = 0;
+    EXPECT_BUS(cap = mcp.getIntCap(B), 1, 3);
+    CHECK(cap == 0x02 && !chip.intAsserted(1));
+}
+
+static void testDeferred(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    mcp.setAllPinsAsOutput();
+    mcp.setDeferred(true);
+    SPI.resetStats();
+
+    EXPECT_BUS((mcp.setPin(0, A, HIGH), mcp.setPin(1, B, HIGH), mcp.setPortPullUp(0x80, A)), 0, 0);
+    CHECK(mcp.hasPendingWrites());
+    EXPECT_BUS(mcp.commit(), 1 + PAIR_FRAMES, 3 + PAIR_BYTES);  // GPPUA, then OLATA/B
+    CHECK(chip.reg(0, S::OLAT) == 0x01 && chip.reg(1, S::OLAT) == 0x02 && chip.reg(0, S::GPPU) == 0x80);
+    CHECK(!mcp.hasPendingWrites());
+    EXPECT_BUS(mcp.commit(), 0, 0);
+}
+
+static void testWriteRegs(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    SPI.resetStats();
+
+    /* IODIRA and the next register: IODIRB (BANK=0) or IPOLA (BANK=1) */
+    const uint8_t vals[] = {0x00, 0x0F};
+    EXPECT_BUS(mcp.writeRegs(MyMCP23S17::IODIRA, vals, 2), 1, 4);
+    CHECK(!mcp.hasPendingWrites());
+    EXPECT_BUS(mcp.commit(), 0, 0);  // nothing reverted
+    if(BANK1){
+        CHECK(mcp.getRegPair(MCP_IODIR) == 0xFF00 && mcp.getRegPair(MCP_IPOL) == 0x000F);
+        CHECK(chip.reg(0, S::IODIR) == 0x00 && chip.reg(0, S::IPOL) == 0x0F);
+    }
+    else{
+        CHECK(mcp.getRegPair(MCP_IODIR) == 0x0F00);
+        CHECK(chip.reg(0, S::IODIR) == 0x00 && chip.reg(1, S::IODIR) == 0x0F);
+    }
+
+    const uint8_t latch = 0x81;
+    mcp.writeRegs(MyMCP23S17::OLATA, &latch, 1);
+    CHECK(mcp.getRegPair(MCP_GPIO) == 0x0081);
+    mcp.setPin(1, A, HIGH);
+    CHECK(chip.reg(0, S::OLAT) == 0x83);
+}
+
+/* hardware address 3: with HAEN=0 (after a reset) the chip only answers address 0 */
+static void testHwAddress(){
+    S chip(&SPI, 5, 3);
+    MyMCP23S17 mcp(&SPI, 5, 99, 3);
+    CHECK(mcp.Init());
+    CHECK(chip.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_HAEN));
+    mcp.setPort(0x5A, A);
+    CHECK(chip.reg(0, S::OLAT) == 0x5A);
+
+    /* restart of the MCU, the chip keeps HAEN (and BANK) */
+    MyMCP23S17 restarted(&SPI, 5, 99, 3);
+    CHECK(restarted.Init());
+    CHECK(chip.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_HAEN) && chip.reg(0, S::OLAT) == 0x00);
+
+    chip.powerOnReset();
+    chip.resetCounters();
+    restarted.setPort(0x5A, A);
+    CHECK(chip.reg(0, S::OLAT) == 0x00 && chip.counters().ignoredFrames == 1);
+    CHECK(restarted.Init());
+    CHECK(chip.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_HAEN));
+}
+
+/* two chips on one CS line: Init() of the second one leaves IOCON of the first one alone */
+static void testSharedCs(){
+    S chip1(&SPI, 5, 1), chip2(&SPI, 5, 2);
+    MyMCP23S17 mcp1(&SPI, 5, 99, 1), mcp2(&SPI, 5, 99, 2);
+    CHECK(mcp1.Init());
+    CHECK(chip1.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_HAEN) && (chip2.reg(0, S::IOCON) & S::IOCON_HAEN));
+    mcp1.setIntMirror(1);
+    mcp1.setInterruptPinPol(HIGH);
+    mcp1.setPortMode(0xFF, A);
+    mcp1.setPort(0x33, A);
+    const uint8_t ioCon1 = IOCON_INIT | S::IOCON_HAEN | S::IOCON_MIRROR | S::IOCON_INTPOL;
+    CHECK(chip1.reg(0, S::IOCON) == ioCon1);
+
+    /* chip2 has HAEN from the address 0 frame of mcp1.Init() already: IOCON read, then Init() 
+     * as without hardware address */
+    SPI.resetStats();
+    EXPECT_BUS(CHECK(mcp2.Init()), BANK1 ? 1 + 5 : 1 + 2, BANK1 ? 3 + 2 * 3 + 10 + 48 : 3 + 48);
+    CHECK(chip1.reg(0, S::IOCON) == ioCon1 && mcp1.getRegPair(MCP_IOCON) == ioCon1 * 0x0101);
+    CHECK(chip2.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_HAEN));
+    mcp2.setPortMode(0xFF, A);
+    mcp2.setPort(0x44, A);
+    CHECK(chip1.reg(0, S::OLAT) == 0x33 && chip2.reg(0, S::OLAT) == 0x44);
+}
+
+/* apply() writes the complete image, verify reads it back; capture() reads it */
+static void testApplyCapture(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    static constexpr MCP23S17Config cfg = MCP23S17Config().withOutputs(0x00FF).withLevels(0x00A5)
+        .withPullUps(0xF000).withPolarity(0x0100).withInterruptOnDefVal(0x0200, 0x0200)
+        .withIoCon(1 << MyMCP23S17::MIRROR);
+    /* GPB1 at its new DEFVAL level, no interrupt. The old DEFVAL / INTCON would cause one if 
+     * GPINTEN was written before them. */
+    chip.driveInputs(0x0200, 0x0200);
+    chip.setReg(1, S::DEFVAL, 0x00);
+    chip.setReg(1, S::INTCON, 0x02);
+    chip.connectIntPins(21, 22);
+    const uint32_t intEdges = hostPinEdges(21) + hostPinEdges(22);
+    SPI.resetStats();
+
+    EXPECT_BUS(CHECK(mcp.apply(cfg, true)), BANK1 ? 3 : 2, BANK1 ? (2 + 8) + 2 * (2 + 22) : 2 * (2 + 22));
+    CHECK(chip.reg(0, S::IODIR) == 0x00 && chip.reg(0, S::OLAT) == 0xA5 && chip.outputLevels() == 0x00A5);
+    CHECK(chip.reg(1, S::GPPU) == 0xF0 && chip.reg(1, S::IPOL) == 0x01 && chip.reg(1, S::GPINTEN) == 0x02);
+    CHECK(chip.reg(1, S::DEFVAL) == 0x02 && chip.reg(1, S::INTCON) == 0x02);
+    CHECK(chip.reg(0, S::IOCON) == (IOCON_INIT | S::IOCON_MIRROR) && !chip.intAsserted(1));
+    CHECK(hostPinEdges(21) + hostPinEdges(22) == intEdges);  // no INT pulse while writing
+    CHECK(!mcp.hasPendingWrites());
+
+    MCP23S17Config read;
+    EXPECT_BUS(read = mcp.capture(), 1, 2 + 22);  // the 22 addresses are consecutive in both layouts
+    CHECK(read.ioDir == cfg.ioDir && read.gppu == cfg.gppu && read.olat == cfg.olat && read.ipol == cfg.ipol);
+    CHECK(read.gpIntEn == cfg.gpIntEn && read.defVal == cfg.defVal && read.intCon == cfg.intCon);
+    CHECK((read.ioCon & (1 << MyMCP23S17::MIRROR)) && mcp.getConfig().olat == cfg.olat);
+
+    MyMCP23S17 missing(&SPI, 7);  // no chip on this CS line
+    CHECK(!missing.apply(cfg, true));
+}
+
+/* IODIR and IPOL of active-low inputs in one frame (BANK=1: one per port) */
+static void testActiveLow(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    mcp.setAllPinsAsOutput();
+    SPI.resetStats();
+
+    /* GPPUB, then IODIR/IPOL: BANK=0 both pairs, BANK=1 IODIRB/IPOLB */
+    EXPECT_BUS(mcp.setPinModes(0x0300, INPUT_PULLUP, 0x0100), 2, BANK1 ? 3 + 4 : 3 + 6);
+    CHECK(chip.reg(1, S::IODIR) == 0x03 && chip.reg(1, S::IPOL) == 0x01 && chip.reg(1, S::GPPU) == 0x03);
+    chip.driveInputs(0x0000, 0x0300);
+    CHECK((mcp.getPort(B) & 0x03) == 0x01);  // GPB0 active low, GPB1 not
+    chip.releaseInputs(0x0300);
+    CHECK((mcp.getPort(B) & 0x03) == 0x02);  // pull-ups
+    SPI.resetStats();
+
+    EXPECT_BUS(mcp.setPinModes(0x0101, INPUT, 0x0001), 2 * PAIR_FRAMES, PAIR_BYTES + (BANK1 ? 2 * 4 : 6));
+    CHECK(chip.reg(0, S::IODIR) == 0x01 && chip.reg(0, S::IPOL) == 0x01 && chip.reg(0, S::GPPU) == 0x00);
+    CHECK(chip.reg(1, S::IPOL) == 0x00 && chip.reg(1, S::GPPU) == 0x02);
+}
+
+static unsigned engineCalls = 0;
+static MCP23S17Event lastEngineEvent;
+
+static void onEngineEvent(const MCP23S17Event &event, void *){
+    engineCalls++;
+    lastEngineEvent = event;
+}
+
+/* INTA (mirrored) on host pin 20, the ISR stores a timestamp, service() decodes */
+static void testInterruptEngine(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    mcp.setIntMirror(1);
+    mcp.setInterruptOnChangePort(0x01, A);
+    mcp.setInterruptOnChangePort(0x80, B);
+    chip.driveInputs(0x0000);
+    chip.connectIntPins(20);
+    MCP23S17InterruptEngine engine;
+    CHECK(engine.addDevice(&mcp) == 0);
+    CHECK(engine.begin(20));
+    CHECK(engine.onPins(0, 0x8000, onEngineEvent));
+    SPI.resetStats();
+
+    chip.driveInputs(0x8001);
+    CHECK(chip.intAsserted(0));
+    uint8_t num = 0;
+    EXPECT_BUS(num = engine.service(), PAIR_FRAMES, BANK1 ? 2 * (2 + 2) : 2 + 4);  // INTF/INTCAP
+    CHECK(num == 2 && !chip.intAsserted(0) && engine.getNumEvents() == 2);
+    MCP23S17Event event;
+    CHECK(engine.getEvent(event) && event.pin == 0 && event.level == 1 && event.device == 0);
+    CHECK(engine.getEvent(event) && event.pin == 15 && event.level == 1);
+    CHECK(engineCalls == 1 && lastEngineEvent.pin == 15);
+
+    /* direct decode: two pins, one of them with a callback */
+    CHECK(engine.decode(0, 0x8001, 0x0001, 1234) == 2);
+    CHECK(engine.getNumEvents() == 2 && engineCalls == 2);
+    CHECK(lastEngineEvent.pin == 15 && lastEngineEvent.level == 0 && lastEngineEvent.timestamp == 1234);
+    CHECK(engine.getEvent(event) && event.pin == 0 && event.level == 1);
+    CHECK(engine.getEvent(event) && event.pin == 15 && !engine.getEvent(event));
+    engine.end();
+}
+
+static unsigned risingCalls = 0;
+
+static void onRising(uint8_t pin, bool level, void *){
+    if(pin == 8 && level){
+        risingCalls++;
+    }
+}
+
+/* only changes are reported, callbacks per edge */
+static void testInputTracker(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    chip.driveInputs(0x0001);
+    MCP23S17InputTracker tracker(&mcp);
+    tracker.begin();
+    CHECK(tracker.getState() == 0x0001);
+    CHECK(tracker.subscribe(0x0100, onRising, nullptr, MCP_RISING));
+    SPI.resetStats();
+
+    MCP23S17Changes changes;
+    EXPECT_BUS(changes = tracker.poll(), PAIR_FRAMES, PAIR_BYTES);
+    CHECK(!changes && risingCalls == 0);
+    chip.driveInputs(0x0100);
+    changes = tracker.poll();
+    CHECK(changes.rising == 0x0100 && changes.falling == 0x0001 && risingCalls == 1);
+    chip.driveInputs(0x0000);
+    changes = tracker.poll();
+    CHECK(changes.rising == 0 && changes.falling == 0x0100 && risingCalls == 1);
+
+    /* interrupt path: only the flagged pins take their captured level */
+    changes = tracker.updateCaptured(0x0102, 0x0100);
+    CHECK(changes.rising == 0x0100 && changes.falling == 0 && tracker.getState() == 0x0100);
+    CHECK(risingCalls == 2);
+    uint8_t pins = 0;
+    for(uint8_t pin : MCP23S17Pins(0x8101)){
+        pins++;
+        CHECK(pin == 0 || pin == 8 || pin == 15);
+    }
+    CHECK(pins == 3);
+}
+
+/* absolute schedule: missed slots are overruns, the snapshot has the ports of the last scan */
+static void testScanner(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    chip.driveInputs(0x1234);
+    MCP23S17Scanner scanner(1000);
+    CHECK(scanner.addDevice(&mcp) == 0);
+    MCP23S17Snapshot snapshot;
+    CHECK(!scanner.getSnapshot(snapshot));
+    scanner.begin();
+
+    CHECK(!scanner.poll());
+    for(uint8_t scans=0; scans<5; ){
+        delayMicroseconds(10);  // loop() polling
+        scans += scanner.poll();
+    }
+    const MCP23S17ScanStats &stats = scanner.getStats();
+    CHECK(stats.scans == 5 && stats.overruns == 0 && stats.maxJitterUs <= 10);
+    CHECK(stats.minPeriodUs >= 990 && stats.maxPeriodUs <= 1010);
+
+    chip.driveInputs(0x4321);
+    delayMicroseconds(3500);
+    CHECK(scanner.poll());
+    CHECK(stats.scans == 6 && stats.overruns == 2);
+    CHECK(stats.maxJitterUs >= 2500 && stats.maxPeriodUs >= 3500);
+    CHECK(scanner.getSnapshot(snapshot) && snapshot.sequence == 6 && snapshot.ports[0] == 0x4321);
+    CHECK(scanner.getPorts(0) == 0x4321 && scanner.getPorts(1) == 0);
+}
+
+#ifndef MyMCP23S17_BANK1
+/* one 4 byte frame per step; the end of a stream without a queued buffer holds the last state */
+static void testSequencer(){
+    S chip(&SPI, 5);
+    MyMCP23S17 mcp(&SPI, 5);
+    mcp.Init();
+    mcp.setAllPinsAsOutput();
+    static const uint16_t first[] = {0x0001, 0x0002, 0x0003};
+    static const uint16_t second[] = {0x0100, 0x0200};
+    MCP23S17Sequencer seq(&mcp, 100);
+    CHECK(seq.play(first, 3, MCP_SEQ_STREAM));
+    SPI.resetStats();
+
+    EXPECT_BUS(CHECK(seq.poll()), 1, 4);
+    CHECK(chip.outputLevels() == 0x0001);
+    CHECK(!seq.poll());  // not due yet
+    for(uint8_t i=0; i<2; i++){
+        delayMicroseconds(100);
+        seq.poll();
+    }
+    CHECK(chip.outputLevels() == 0x0003 && seq.getStats().underruns == 1);
+    SPI.resetStats();
+    delayMicroseconds(100);
+    EXPECT_BUS(seq.poll(), 0, 0);  // underrun: the slot holds 0x0003
+    CHECK(chip.outputLevels() == 0x0003 && mcp.getRegPair(MCP_GPIO) == 0x0003);
+
+    CHECK(seq.queue(second, 2));
+    delayMicroseconds(100);
+    CHECK(seq.poll() && chip.outputLevels() == 0x0100);
+    delayMicroseconds(100);
+    CHECK(seq.poll() && chip.outputLevels() == 0x0200 && mcp.getRegPair(MCP_GPIO) == 0x0200);
+    CHECK(seq.getStats().steps == 5 && seq.getStats().underruns == 2 && seq.getStats().busyJobs == 0);
+    seq.stop();
+}
+#endif
+
+/* compile time front-end: constant opcode and register, one 3 byte frame per call */
+static void testFixed(){
+    S chip(&SPI, 5), other(&SPI, 6, 2);
+    MCP23S17<5> mcp(&SPI);
+    MCP23S17<6, 2> addressed(&SPI);
+    CHECK(mcp.Init() && addressed.Init());
+    mcp.setAllPinsAsOutput();
+    addressed.setAllPinsAsOutput();
+    SPI.resetStats();
+
+    EXPECT_BUS((mcp.setPin<A, 3>(HIGH)), 1, 3);
+    CHECK(chip.reg(0, S::OLAT) == 0x08);
+    auto led = mcp.pin<B, 7>();
+    EXPECT_BUS(led.toggle(), 1, 3);
+    CHECK(chip.reg(1, S::OLAT) == 0x80 && mcp.getRegPair(MCP_GPIO) == 0x8008);
+    EXPECT_BUS(mcp.setPort<B>(0x55), 1, 3);
+    CHECK(chip.outputLevels() == 0x5508);
+
+    EXPECT_BUS(addressed.setPort<A>(0xC3), 1, 3);
+    CHECK(other.reg(0, S::OLAT) == 0xC3 && chip.reg(0, S::OLAT) == 0x08);
+
+    auto in = addressed.port<B>();
+    in.setMode(0x00, INPUT_PULLUP);  // bit = 1: output
+    other.driveInputs(0x0500, 0x0F00);
+    SPI.resetStats();
+    uint8_t val = 0;
+    EXPECT_BUS(val = in.get(), 1, 3);
+    CHECK(val == 0xF5 && other.reg(1, S::GPPU) == 0xFF);
+}
+
+/* resyncShadow() reads OLAT and IODIR...GPPU (BANK=1: per port), adoptDeviceState() takes a 
+ * configured device over without writing and refuses a reset one */
+static void testResyncAndAdopt(){
+    S chip(&SPI, 5);
+    {
+        MyMCP23S17 mcp(&SPI, 5);
+        CHECK(mcp.Init());
+        mcp.setPinModes(0x00F0, OUTPUT);
+        mcp.writePins(0x00F0, 0x0050);
+        mcp.setPortPullUp(0x0F, B);
+        chip.setReg(1, S::IPOL, 0x03);  // changed behind the back of the mirror
+        SPI.resetStats();
+        EXPECT_BUS(mcp.resyncShadow(), PAIR_FRAMES, BANK1 ? 2 * (2 + 8) : 2 + 16);
+        CHECK(mcp.getRegPair(MCP_IPOL) == 0x0300 && mcp.getRegPair(MCP_GPIO) == 0x0050);
+        CHECK(!mcp.hasPendingWrites());
+    }
+    {
+        MyMCP23S17 mcp(&SPI, 5);  // restart of the MCU
+        SPI.resetStats();
+        /* IOCON probes (BANK=0: both layouts, BANK=1: its own), then the state */
+        const uint32_t probes = BANK1 ? 2 : 4;
+        EXPECT_BUS(CHECK(mcp.adoptDeviceState()), probes + PAIR_FRAMES, probes * 3 + (BANK1 ? 2 * (2 + 8) : 2 + 16));
+        CHECK(mcp.getRegPair(MCP_IODIR) == 0xFF0F && mcp.getRegPair(MCP_GPIO) == 0x0050);
+        CHECK(mcp.getRegPair(MCP_GPPU) == 0x0F00 && mcp.getRegPair(MCP_IOCON) == IOCON_INIT * 0x0101);
+        CHECK(chip.outputLevels() == 0x0050);
+        mcp.setPin(0, B, HIGH);  // GPB0 is an input, only OLATB changes
+        CHECK(chip.reg(1, S::OLAT) == 0x01 && chip.reg(0, S::OLAT) == 0x50);
+    }
+    chip.powerOnReset();
+    {
+        MyMCP23S17 mcp(&SPI, 5);
+        CHECK(!mcp.adoptDeviceState());
+        CHECK(mcp.Init());
+    }
+
+    /* configured in the other layout: GPINTENB (BANK=0) / OLATA (BANK=1) is no IOCON */
+    S other(&SPI, 6);
+    other.setReg(0, S::IODIR, 0x0F);
+    other.setReg(1, S::GPINTEN, 0x80);
+    other.setReg(0, S::IOCON, BANK1 ? 0x00 : S::IOCON_BANK);
+    {
+        MyMCP23S17 mcp(&SPI, 6);
+        CHECK(!mcp.adoptDeviceState());
+    }
+}
+
+/* check() reads the image back; after a reset of the chip recover() writes it again. With a 
+ * hardware address the reset chip only answers address 0 until HAEN is set again. */
+static void testHealth(S &chip, MyMCP23S17 &mcp, uint8_t ioCon){
+    CHECK(mcp.Init());
+    mcp.setPinModes(0x000F, OUTPUT);
+    mcp.writePins(0x000F, 0x0005);
+    mcp.setPortPullUp(0xF0, B);
+    mcp.setInterruptOnChangePort(0x30, B);
+    MCP23S17Health health(0, true);
+    health.addDevice(&mcp);
+    SPI.resetStats();
+
+    EXPECT_BUS(CHECK(health.check(0)), PAIR_FRAMES, BANK1 ? 2 * (2 + 8) : 2 + 16);
+    CHECK(health.getStats().checks == 1 && health.getStats().mismatches == 0);
+
+    chip.powerOnReset();
+    CHECK(health.check(0));
+    CHECK(health.getStats().mismatches == 1 && health.getStats().recoveries == 1);
+    CHECK(health.getStats().failedRecoveries == 0);
+    CHECK(chip.reg(0, S::IOCON) == ioCon && chip.reg(0, S::OLAT) == 0x05 && chip.reg(0, S::IODIR) == 0xF0);
+    CHECK(chip.reg(1, S::GPPU) == 0xF0 && chip.reg(1, S::GPINTEN) == 0x30);
+    CHECK(chip.outputLevels() == 0x0005);
+    CHECK(health.check(0) && health.getStats().mismatches == 1);
+}
+
+static void testHealth(){
+    {
+        S chip(&SPI, 5);
+        MyMCP23S17 mcp(&SPI, 5);
+        testHealth(chip, mcp, IOCON_INIT);
+    }
+    {
+        S chip(&SPI, 5, 3);
+        MyMCP23S17 mcp(&SPI, 5, 99, 3);
+        testHealth(chip, mcp, IOCON_INIT | S::IOCON_HAEN);
+    }
+}
+
+static void testBus(){
+    S chip0(&SPI, 5), chip1(&SPI, 6);
+    MyMCP23S17 mcp0(&SPI, 5), mcp1(&SPI, 6);
+    MCP23S17Bus bus(&SPI);
+    bus.addDevice(&mcp0);
+    bus.addDevice(&mcp1);
+    CHECK(bus.Init());
+    mcp0.setAllPinsAsOutput();
+    mcp1.setAllPinsAsOutput();
+    SPI.resetStats();
+
+    bus.setPort(0, 0x11, A);
+    bus.setPorts(1, 0x22, 0x33);
+    bus.flush();
+    CHECK(SPI.stats().transactions == 1);
+    EXPECT_BUS((void)0, 1 + PAIR_FRAMES, 3 + PAIR_BYTES);
+    CHECK(chip0.reg(0, S::OLAT) == 0x11 && chip1.reg(0, S::OLAT) == 0x22 && chip1.reg(1, S::OLAT) == 0x33);
+
+    uint16_t ports[2] = {};
+    bus.scanAll(ports);
+    CHECK(SPI.stats().transactions == 1);
+    EXPECT_BUS((void)0, 2 * PAIR_FRAMES, 2 * PAIR_BYTES);
+    CHECK(ports[0] == 0x0011 && ports[1] == 0x3322);
+
+    CHECK(bus.setSPIClockSpeed(4000000));
+    mcp1.setPin(0, A, HIGH);
+    CHECK(SPI.clock() == 4000000);
+}
+
+int main(){
+    testInit();
+    testOutputs();
+    testInputs();
+    testInterrupts();
+    testDeferred();
+    testWriteRegs();
+    testHwAddress();
+    testSharedCs();
+    testResyncAndAdopt();
+    testHealth();
+    testBus();
+    testApplyCapture();
+    testActiveLow();
+    testInterruptEngine();
+    testInputTracker();
+    testScanner();
+#ifndef MyMCP23S17_BANK1
+    testSequencer();
+#endif
+    testFixed();
+    printf("%u check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -18,9 +18,73 @@ https://wolles-elektronikkiste.de/portexpander-mcp23017       (German)
 #include "MyMCP23S17.h"
 
 bool MyMCP23S17::Init(){
+    MCP_INSTRUMENT_API();
+    if(!beginBus()){
+        return false;
+    }
+
+    /* HAEN without touching configured devices on the same CS line */
+#ifdef MyMCP23S17_BANK1
+    selectBank1();
+#else
+    restoreHwAddressing();
+#endif
+
+    /* Reset image (incl. IOCON.HAEN if a hardware address is used) in one frame, read back in 
+     * a second one. The image contains 0x00 and 0xFF bytes, so a missing device is detected 
+     * whether MISO floats high or low. */
+    return apply(MCP23S17Config(), true);
+};
+
+bool MyMCP23S17::adoptDeviceState(){
+    MCP_INSTRUMENT_API();
+    if(!beginBus()){
+        return false;
+    }
+    /* IOCON is probed in both layouts first, a device in the other one (firmware built with the 
+     * other MyMCP23S17_BANK1 setting) would show GPINTENB (BANK=0) or OLATA (BANK=1) as IOCON. 
+     * A layout fits if both copies of IOCON are equal and BANK matches. In BANK=1 the second 
+     * BANK=0 copy (0x0B) is unimplemented and reads 0, so with OLATA = 0 both layouts fit: 
+     * BANK=0 is only taken if BANK=1 does not fit. BANK=1 is checked with its own copies only. */
+    uint8_t bank1[] = {read(IOCON_BANK1), read(IOCON_BANK1 + 0x10)};
+    bool fitsBank1 = bank1[0] == bank1[1] && (bank1[0] & (1<<BANK));
+#ifdef MyMCP23S17_BANK1
+    if(!fitsBank1){
+        return false;
+    }
+#else
+    uint8_t bank0[] = {read(IOCON_BANK0), read(IOCON_BANK0 + 1)};
+    bool fitsBank0 = bank0[0] == bank0[1] && !(bank0[0] & (1<<BANK));
+    if(!fitsBank0 || fitsBank1){
+        return false;
+    }
+#endif
+    resyncShadow();
+    uint8_t expected = useHwAddress ? (1<<HAEN) : 0;
+#ifdef MyMCP23S17_BANK1
+    expected |= (1<<BANK);
+#endif
+    uint8_t fixedBits = (1<<BANK) | (1<<SEQOP) | (1<<HAEN);
+    if((getIoCon(A) & fixedBits) != expected){
+        return false;
+    }
+    /* With BANK=0 and without HAEN a reset device passes the IOCON check. Its power-on state 
+     * (all inputs, everything else 0) is refused, Init() cannot change outputs then. */
+    bool powerOnState = regPairs[MCP_IODIR] == 0xFFFF && regPairs[MCP_GPIO] == 0;
+    for(uint8_t reg=MCP_IPOL; reg<=MCP_GPPU; reg++){
+        powerOnState = powerOnState && regPairs[reg] == 0;
+    }
+    return !powerOnState;
+}
+
+/* CS pin, reset pin and bus lock, no SPI frames. false if the CS pin is no output GPIO. */
+bool MyMCP23S17::beginBus(){
+#ifdef MyMCP23S17_THREAD_SAFE
+    busLock = MCP23S17BusLock::forBus(_spi);
+#endif
 
 #ifdef MyMCP23S17_USE_ESP32_REG_WRITE
-    if (csPin > 31) {
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(csPin)) {
         return false;
     }
 #endif
@@ -29,609 +93,645 @@ bool MyMCP23S17::Init(){
     _spi->setHwCs(true);
 #endif
 
-    setCsPinMode();
-    setCsPinHigh();
+    if(!usesIdfDevice()){
+        setCsPinMode();
+        setCsPinHigh();
+    }
     
     if(resetPin < 99){ 
         pinMode(resetPin, OUTPUT); 
         digitalWrite(resetPin, HIGH);
     }
-
-    softReset();
-    
-    // setIoCon(0b00001000, A); // enable SPI hardware address
-    // setIoCon(0b00001000, B); // enable SPI hardware address
-
-    setIoCon(0b00000000, A); // disable SPI hardware address
-    setIoCon(0b00000000, B); // disable SPI hardware address
-
-    setIntCon(0b10101010, A);
-    if(read(INTCONA) != 0b10101010){
-        return false;
-    }
-
-    setIntCon(0, A);
-
-    ioDirA = 0b00000000;
-    ioDirB = 0b00000000;
-    gpioA = 0b00000000;
-    gpioB = 0b00000000;
-    
-    mySPISettings = SPISettings(SPI_CLOCKSPEED, MSBFIRST, SPI_MODE0); 
-
     return true;
-};
+}
 
 void MyMCP23S17::reset(){
+    MCP_INSTRUMENT_API();
     digitalWrite(resetPin,LOW);
     delay(10);
     digitalWrite(resetPin, HIGH);
     delay(10);
+    if(useHwAddress){
+        enableHwAddressing();
+    }
+    setShadowToResetValues();
+#ifdef MyMCP23S17_BANK1
+    selectBank1();
+#endif
 }
 
-void MyMCP23S17::setPinMode(uint8_t pin, mcp_port port, uint8_t pinState){
-    uint8_t gppu = getPortPullUp(port);
-    if(port==A){
-        if(pinState==OUTPUT){
-            ioDirA &= ~(1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT){
-            ioDirA |= (1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT_PULLUP){
-            ioDirA |= (1<<pin);
-            gppu |= (1<<pin);
-        }
-        write(GPPUA, gppu);
-        write(IODIRA, ioDirA); 
+/* As long as IOCON.HAEN is disabled, a device ignores its A2..A0 pins. Writing IOCON.HAEN 
+ * with all eight addresses therefore reaches every device on this CS line, afterwards each 
+ * device only listens to the address set by its A2..A0 pins. Other IOCON bits of all devices 
+ * are cleared, so call it before configuring the devices; Init() uses restoreHwAddressing(). The frames use the BANK=0 
+ * address of IOCON. With MyMCP23S17_BANK1, devices still in BANK=1 (restart of the MCU only) 
+ * would take it as OLATA, so all eight addresses first get HAEN at the BANK=1 address of 
+ * IOCON, which clears BANK (in BANK=0 this address is GPINTENB, the reset image overwrites 
+ * it). Once HAEN is set everywhere, a third round sets BANK: each device takes exactly one 
+ * of these frames, so all devices on the CS line end up in BANK=1. */
+void MyMCP23S17::enableHwAddressing(){
+    MCP_INSTRUMENT_API();
+    startBatch();
+#ifdef MyMCP23S17_BANK1
+    broadcastIoCon(IOCON_BANK1, (1<<HAEN));
+#endif
+    broadcastIoCon(IOCON_BANK0, (1<<HAEN));
+#ifdef MyMCP23S17_BANK1
+    broadcastIoCon(IOCON_BANK0, (1<<HAEN) | (1<<BANK));
+#endif
+    endBatch();
+}
+
+void MyMCP23S17::broadcastIoCon(uint8_t ioConAddr, uint8_t val){
+    for(uint8_t addr=0; addr<8; addr++){
+        uint8_t buffer[] = {(uint8_t)(OPCODE_WRITE | (addr<<1)), ioConAddr, val};
+        transferFrame(buffer, sizeof(buffer), false);
     }
-    else if(port==B){
-        if(pinState==OUTPUT){
-            ioDirB &= ~(1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT){
-            ioDirB |= (1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT_PULLUP){
-            ioDirB |= (1<<pin);
-            gppu |= (1<<pin);
-        }
-        write(GPPUB, gppu);
-        write(IODIRB, ioDirB);
-    }       
 }
 
-void MyMCP23S17::setPortMode(uint8_t portState, mcp_port port){
-    if(port==A){
-        ioDirA = ~portState;
-        write(IODIRA, ioDirA);
-        write(GPPUA, 0);
+/* Switches the device to BANK=1, whatever layout it is in. The first frame writes IOCON at its 
+ * BANK=1 address and clears BANK (in BANK=0 this address is GPINTENB, which has to be written 
+ * afterwards), the second one sets BANK at the BANK=0 address. IOCON gets the value of the 
+ * mirror, HAEN included. A device which was reset only answers address 0, see 
+ * restoreHwAddressing(). */
+void MyMCP23S17::selectBank1(){
+    uint8_t ioConVal = (getIoCon(A) | (useHwAddress ? (1<<HAEN) : 0)) & ~(1<<BANK);
+    uint8_t toBank0[] = {(uint8_t)(SPI_Address<<1), IOCON_BANK1, ioConVal};
+    uint8_t toBank1[] = {(uint8_t)(SPI_Address<<1), IOCON_BANK0, (uint8_t)(ioConVal | (1<<BANK))};
+    restoreHwAddressing();
+    startBatch();
+    transferFrame(toBank0, sizeof(toBank0), false);
+    transferFrame(toBank1, sizeof(toBank1), false);
+    endBatch();
+    noteDeviceReg(IOCONA, ioConVal | (1<<BANK));
+}
+
+/* With HAEN=0 (after a reset) the address pins are ignored and the device only answers 
+ * address 0. If IOCON read at the own address has no HAEN (or nobody answered: 0xFF, bit 0 
+ * of IOCON reads 0), IOCON is written with address 0 at its BANK=0 address: HAEN set, the 
+ * other bits from the mirror. Unlike enableHwAddressing() a configured device on the same 
+ * CS line keeps its IOCON, unless it has address 0 itself. With MyMCP23S17_BANK1 a device 
+ * in BANK=1 first gets BANK cleared at the BANK=1 address (in BANK=0 this is GPINTENB, the 
+ * image overwrites it) and all devices answering address 0 end up in BANK=1. */
+void MyMCP23S17::restoreHwAddressing(){
+    if(!useHwAddress || (SPI_Address & 0x07) == 0){
+        return;
     }
-    else if(port==B){
-        ioDirB = ~portState;
-        write(IODIRB, ioDirB);
-        write(GPPUB, 0);
+    uint8_t ioCon = read(IOCONA);
+    if(ioCon != 0xFF && (ioCon & (1<<HAEN))){
+        return;
     }
+    uint8_t ioConVal = getIoCon(A) & ~((1<<BANK) | (1<<HAEN));
+    startBatch();
+#ifdef MyMCP23S17_BANK1
+    uint8_t toBank0[] = {OPCODE_WRITE, IOCON_BANK1, ioConVal};
+    transferFrame(toBank0, sizeof(toBank0), false);
+    ioConVal |= (1<<BANK);
+#endif
+    uint8_t haen[] = {OPCODE_WRITE, IOCON_BANK0, (uint8_t)(ioConVal | (1<<HAEN))};
+    transferFrame(haen, sizeof(haen), false);
+    endBatch();
+}
+
+void MyMCP23S17::setPinMode(uint8_t pin, mcp_port port, uint8_t pinState){
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    updatePinModes(mask, pinState);
+    if(pairDiffers(MCP_GPPU, mask)){
+        writePair(MCP_GPPU, mask);
+    }
+    writePair(MCP_IODIR, mask);
+}
+
+void MyMCP23S17::setPortMode(uint8_t portState, mcp_port port){
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_IODIR, mask, portBits(~portState, port));
+    updatePair(MCP_GPPU, mask, 0);
+    writePair(MCP_IODIR, mask);
+    writePair(MCP_GPPU, mask);
 }
 
 void MyMCP23S17::setPortMode(uint8_t portState, mcp_port port, uint8_t pu){
-    uint8_t gppu = getPortPullUp(port);
+    MCP_INSTRUMENT_API();
     if(pu != INPUT_PULLUP){
         return;
     }
-    if(port==A){
-        ioDirA = ~portState;
-        gppu = ~portState;
-        write(GPPUA, gppu);
-        write(IODIRA, ioDirA); 
-    }
-    else if(port==B){
-        ioDirB = ~portState;
-        gppu = ~portState;
-        write(GPPUB, gppu);
-        write(IODIRB, ioDirB);
-    }
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_IODIR, mask, portBits(~portState, port));
+    updatePair(MCP_GPPU, mask, portBits(~portState, port));
+    writePair(MCP_GPPU, mask);
+    writePair(MCP_IODIR, mask);
 }
 
 void MyMCP23S17::setPin(uint8_t pin, mcp_port port, uint8_t pinLevel, bool useTransaction){
-
-    if(port==A){
-        if(pinLevel==HIGH){
-            gpioA |= (1<<pin); 
-        }
-        else if(pinLevel==LOW){
-            gpioA &= ~(1<<pin); 
-        }
-        write(GPIOA, gpioA, useTransaction);
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    if(pinLevel==HIGH){
+        MCP_SHADOW_SET(regPairs[MCP_GPIO], mask); 
     }
-
-    if(port==B){
-        if(pinLevel==HIGH){
-            gpioB |= (1<<pin); 
-        }
-        else if(pinLevel==LOW){
-            gpioB &= ~(1<<pin); 
-        }
-        write(GPIOB, gpioB, useTransaction);
+    else if(pinLevel==LOW){
+        MCP_SHADOW_CLR(regPairs[MCP_GPIO], mask); 
     }
+    writePair(MCP_GPIO, mask, useTransaction);
 }
 
 void MyMCP23S17::togglePin(uint8_t pin, mcp_port port, bool useTransaction){
-    if(port==A){
-        if(((gpioA) & (1<<pin))==0){
-            gpioA |= (1<<pin); 
-        }
-        else if(((gpioA) & (1<<pin)) >= 1){
-            gpioA &= ~(1<<pin); 
-        }
-        write(GPIOA, gpioA, useTransaction);
-    }
-    if(port==B){
-        if(((gpioB) & (1<<pin))==0){
-            gpioB |= (1<<pin); 
-        }
-        else if(((gpioB) & (1<<pin)) >= 1){
-            gpioB &= ~(1<<pin); 
-        }
-        write(GPIOB, gpioB, useTransaction);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    MCP_SHADOW_TGL(regPairs[MCP_GPIO], mask);
+    writePair(MCP_GPIO, mask, useTransaction);
 }
 
 void MyMCP23S17::setPinX(uint8_t pin, mcp_port port, uint8_t pinState, uint8_t pinLevel){
-    uint8_t gppu = getPortPullUp(port);
-    if(port==A){
-        if(pinState==OUTPUT){
-            ioDirA &= ~(1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT){
-            ioDirA |= (1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT_PULLUP){
-            ioDirA |= (1<<pin);
-            gppu |= (1<<pin);
-        }
-        if(pinLevel==HIGH){
-            gpioA |= (1<<pin); 
-        }
-        else if(pinLevel==LOW){
-            gpioA &= ~(1<<pin); 
-        }
-        write(GPPUA, gppu);
-        write(IODIRA, ioDirA);
-        write(GPIOA, gpioA);
-    }
-    if(port==B){
-        if(pinState==OUTPUT){
-            ioDirB &= ~(1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT){
-            ioDirB |= (1<<pin);
-            gppu &= ~(1<<pin);
-        }
-        else if(pinState==INPUT_PULLUP){
-            ioDirB |= (1<<pin);
-            gppu |= (1<<pin);
-        }
-        if(pinLevel==HIGH){
-            gpioB |= (1<<pin); 
-        }
-        else if(pinLevel==LOW){
-            gpioB &= ~(1<<pin); 
-        }
-        write(GPPUB, gppu);
-        write(IODIRB, ioDirB);
-        write(GPIOB, gpioB);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    updatePinModes(mask, pinState);
+    if(pinLevel==HIGH){
+        MCP_SHADOW_SET(regPairs[MCP_GPIO], mask); 
+    }
+    else if(pinLevel==LOW){
+        MCP_SHADOW_CLR(regPairs[MCP_GPIO], mask); 
+    }
+    writePair(MCP_GPPU, mask);
+    writePair(MCP_IODIR, mask);
+    writePair(MCP_GPIO, mask);
 }
 
 void MyMCP23S17::setAllPins(mcp_port port, uint8_t pinLevel, bool useTransaction){
-    if(port==A){
-        if(pinLevel==HIGH){
-            gpioA = 0b11111111;
-        }
-        else if (pinLevel==LOW){
-            gpioA = 0b00000000;
-        }
-        write(GPIOA, gpioA, useTransaction);
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    if(pinLevel==HIGH){
+        updatePair(MCP_GPIO, mask, 0xFFFF);
     }
-    if(port==B){
-        if(pinLevel==HIGH){
-            gpioB = 0b11111111;
-        }
-        else if (pinLevel==LOW){
-            gpioB = 0b00000000;
-        }
-        write(GPIOB, gpioB, useTransaction);
+    else if (pinLevel==LOW){
+        updatePair(MCP_GPIO, mask, 0);
     }
+    writePair(MCP_GPIO, mask, useTransaction);
 }
 
 void MyMCP23S17::setPort(uint8_t portLevel, mcp_port port, bool useTransaction){
-    if(port==A){
-        gpioA = portLevel;
-        write(GPIOA, gpioA, useTransaction);
-    }
-    else if(port==B){
-        gpioB = portLevel;
-        write(GPIOB, gpioB, useTransaction);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_GPIO, mask, portBits(portLevel, port));
+    writePair(MCP_GPIO, mask, useTransaction);
 }
 
 void MyMCP23S17::setPorts(uint8_t portLevelA, uint8_t portLevelB, bool useTransaction){
-    gpioA = portLevelA;
-    gpioB = portLevelB;
-    write(GPIOA, gpioA, gpioB, useTransaction);
+    MCP_INSTRUMENT_API();
+    regPairs[MCP_GPIO] = (uint16_t)portLevelB << 8 | portLevelA;
+    writePair(MCP_GPIO, 0xFFFF, useTransaction);
 }
 
 void MyMCP23S17::setPortX(uint8_t portState, uint8_t portLevel, mcp_port port){
-    if(port==A){
-        ioDirA = ~portState;
-        gpioA = portLevel;
-        write(IODIRA, ioDirA);
-        write(GPIOA, gpioA);
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_IODIR, mask, portBits(~portState, port));
+    updatePair(MCP_GPIO, mask, portBits(portLevel, port));
+    writePair(MCP_IODIR, mask);
+    writePair(MCP_GPIO, mask);
+}
+
+void MyMCP23S17::writePins(uint16_t mask, uint16_t values, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    updatePair(MCP_GPIO, mask, values);
+    writePair(MCP_GPIO, mask, useTransaction);
+}
+
+void MyMCP23S17::togglePins(uint16_t mask, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    MCP_SHADOW_TGL(regPairs[MCP_GPIO], mask);
+    writePair(MCP_GPIO, mask, useTransaction);
+}
+
+void MyMCP23S17::setPinModes(uint16_t mask, uint8_t pinState){
+    MCP_INSTRUMENT_API();
+    updatePinModes(mask, pinState);
+    if(pairDiffers(MCP_GPPU, mask)){
+        writePair(MCP_GPPU, mask);
     }
-    else if(port==B){
-        ioDirB = ~portState;
-        gpioB = portLevel;
-        write(IODIRB, ioDirB);
-        write(GPIOB, gpioB);
+    writePair(MCP_IODIR, mask);
+}
+
+void MyMCP23S17::setPinModes(uint16_t mask, uint8_t pinState, uint16_t activeLow){
+    MCP_INSTRUMENT_API();
+    updatePinModes(mask, pinState);
+    updatePair(MCP_IPOL, mask, activeLow);
+    if(pairDiffers(MCP_GPPU, mask)){
+        writePair(MCP_GPPU, mask);
     }
+    writePairs(MCP_IODIR, MCP_IPOL, mask);
 }
 
 void MyMCP23S17::setInterruptPinPol(uint8_t level){
-    uint8_t ioConA = getIoCon(A);
-    uint8_t ioConB = getIoCon(B);
+    MCP_INSTRUMENT_API();
+    uint8_t ioConVal = getIoCon(A);
     if(level==HIGH){
-        ioConA |= (1<<INTPOL);
-        ioConB |= (1<<INTPOL);
+        ioConVal |= (1<<INTPOL);
     }
     if(level==LOW){
-        ioConA &= ~(1<<INTPOL);
-        ioConB &= ~(1<<INTPOL);
+        ioConVal &= ~(1<<INTPOL);
     }
-    write(IOCONA, ioConA);
-    write(IOCONB, ioConB);
+    setIoCon(ioConVal, A);
 }   
 
 void MyMCP23S17::setIntOdr(uint8_t openDrain){
-    uint8_t ioConA = getIoCon(A);
-    uint8_t ioConB = getIoCon(B);
+    MCP_INSTRUMENT_API();
+    uint8_t ioConVal = getIoCon(A);
     if(openDrain){
-        ioConA |= (1<<INTODR);
-        ioConB |= (1<<INTODR);
+        ioConVal |= (1<<INTODR);
     }
     else{
-        ioConA &= ~(1<<INTODR);
-        ioConB &= ~(1<<INTODR);
+        ioConVal &= ~(1<<INTODR);
     }
-    write(IOCONA, ioConA);
-    write(IOCONB, ioConB);
+    setIoCon(ioConVal, A);
 }   
 
 void MyMCP23S17::setInterruptOnChangePin(uint8_t pin, mcp_port port){
-    uint8_t gpIntEn = getGpIntEn(port);
-    if(port==A){
-        ioDirA |= (1<<pin); 
-        gpIntEn |= (1<<pin);
-        write(IODIRA, ioDirA);
-        write(GPIOA, gpioA);
-        write(GPINTENA, gpIntEn);
-    }
-    else if (port==B){
-        ioDirB |= (1<<pin); 
-        gpIntEn |= (1<<pin);
-        write(IODIRB, ioDirB);
-        write(GPIOB, gpioB);
-        write(GPINTENB, gpIntEn);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    MCP_SHADOW_SET(regPairs[MCP_IODIR], mask); 
+    MCP_SHADOW_SET(regPairs[MCP_GPINTEN], mask);
+    writePairs(MCP_IODIR, MCP_GPINTEN, mask);
 }
 
 void MyMCP23S17::setInterruptOnDefValDevPin(uint8_t pin, mcp_port port, uint8_t pinIntLevel){
-    uint8_t gpIntEn = getGpIntEn(port);
-    uint8_t intCon = getIntCon(port);
-    uint8_t defVal = getDefVal(port);
-    if(port==A){
-        ioDirA |= (1<<pin); 
-        gpIntEn |= (1<<pin);
-        intCon |= (1<<pin);
-        if(pinIntLevel==HIGH) defVal |= (1<<pin);
-        else if(pinIntLevel==LOW) defVal &= ~(1<<pin);
-        write(IODIRA, ioDirA);
-        write(GPIOA, gpioA);
-        write(GPINTENA, gpIntEn);
-        write(INTCONA, intCon);
-        write(DEFVALA, defVal);
-    }
-    else if (port==B){
-        ioDirB |= (1<<pin); 
-        gpIntEn |= (1<<pin);
-        intCon |= (1<<pin);
-        if(pinIntLevel==HIGH) defVal |= (1<<pin);
-        else if(pinIntLevel==LOW) defVal &= ~(1<<pin);
-        write(IODIRB, ioDirB);
-        write(GPIOB, gpioB);
-        write(GPINTENB, gpIntEn);
-        write(INTCONB, intCon);
-        write(DEFVALB, defVal);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    MCP_SHADOW_SET(regPairs[MCP_IODIR], mask); 
+    MCP_SHADOW_SET(regPairs[MCP_GPINTEN], mask);
+    MCP_SHADOW_SET(regPairs[MCP_INTCON], mask);
+    if(pinIntLevel==HIGH) MCP_SHADOW_SET(regPairs[MCP_DEFVAL], mask);
+    else if(pinIntLevel==LOW) MCP_SHADOW_CLR(regPairs[MCP_DEFVAL], mask);
+    writePairs(MCP_IODIR, MCP_INTCON, mask);
 }
 
 void MyMCP23S17::setInterruptOnChangePort(uint8_t intOnChangePins, mcp_port port){
-    if(port==A){
-        ioDirA |= intOnChangePins;
-        write(IODIRA, ioDirA);
-        write(GPINTENA, intOnChangePins);
-    }
-    else if (port==B){
-        ioDirB |= intOnChangePins;
-        write(IODIRB, ioDirB);
-        write(GPINTENB, intOnChangePins);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    MCP_SHADOW_SET(regPairs[MCP_IODIR], portBits(intOnChangePins, port));
+    updatePair(MCP_GPINTEN, mask, portBits(intOnChangePins, port));
+    writePair(MCP_IODIR, mask);
+    writePair(MCP_GPINTEN, mask);
 }
 
 void MyMCP23S17::setInterruptOnDefValDevPort(uint8_t intPins, mcp_port port, uint8_t defVal){
-    uint8_t gpIntEn = getGpIntEn(port);
-    uint8_t intCon = getIntCon(port);
-    intCon |= intPins;
-    gpIntEn |= intPins;
-    if(port==A){
-        ioDirA |= intPins; 
-        write(IODIRA, ioDirA);
-        write(GPINTENA, gpIntEn);
-        write(INTCONA, intCon);
-        write(DEFVALA, defVal);
-    }
-    else if (port==B){
-        ioDirB |= intPins; 
-        write(IODIRB, ioDirB);
-        write(GPINTENB, gpIntEn);
-        write(INTCONB, intCon);
-        write(DEFVALB, defVal);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    uint16_t pins = portBits(intPins, port);
+    MCP_SHADOW_SET(regPairs[MCP_IODIR], pins); 
+    MCP_SHADOW_SET(regPairs[MCP_GPINTEN], pins);
+    MCP_SHADOW_SET(regPairs[MCP_INTCON], pins);
+    updatePair(MCP_DEFVAL, mask, portBits(defVal, port));
+    writePairs(MCP_IODIR, MCP_INTCON, mask);
 }
 
 void MyMCP23S17::deleteAllInterruptsOnPort(mcp_port port){
-    if(port==A){
-        write(GPINTENA, 0);
-    }
-    else if (port==B){
-        write(GPINTENB, 0);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_GPINTEN, mask, 0);
+    writePair(MCP_GPINTEN, mask);
 }
 
 void MyMCP23S17::setPinPullUp(uint8_t pin, mcp_port port, uint8_t pinLevel){
-    uint8_t gppu = getPortPullUp(port);
-    if(port==A){
-        if(pinLevel==HIGH){
-            gppu |= (1<<pin);
-        }
-        else if(pinLevel==LOW){
-            gppu &= ~(1<<pin);
-        }
-        write(GPPUA, gppu);
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    if(pinLevel==HIGH){
+        MCP_SHADOW_SET(regPairs[MCP_GPPU], mask);
     }
-    else if(port==B){
-        if(pinLevel==HIGH){
-            gppu |= (1<<pin);
-        }
-        else if(pinLevel==LOW){
-            gppu &= ~(1<<pin);
-        }
-        write(GPPUB, gppu);
+    else if(pinLevel==LOW){
+        MCP_SHADOW_CLR(regPairs[MCP_GPPU], mask);
     }
+    writePair(MCP_GPPU, mask);
 }
         
 void MyMCP23S17::setPortPullUp(uint8_t pulledUpPins, mcp_port port){
-    if(port==A){
-        write(GPPUA, pulledUpPins);
-    }
-    else if(port==B){
-        write(GPPUB, pulledUpPins);
-    }
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_GPPU, mask, portBits(pulledUpPins, port));
+    writePair(MCP_GPPU, mask);
 }
 
 uint8_t MyMCP23S17::getPortPullUp(mcp_port port){
-    if(port==A){
-        return read(GPPUA);
+    MCP_INSTRUMENT_API();
+    return portValue(MCP_GPPU, port);
+}      
+
+void MyMCP23S17::setPinPolarity(uint8_t pin, mcp_port port, bool inverted){
+    MCP_INSTRUMENT_API();
+    uint16_t mask = pinMask(pin, port);
+    if(inverted){
+        MCP_SHADOW_SET(regPairs[MCP_IPOL], mask);
     }
-    else{ 
-        return read(GPPUB);
+    else{
+        MCP_SHADOW_CLR(regPairs[MCP_IPOL], mask);
     }
-}      
+    writePair(MCP_IPOL, mask);
+}
+
+void MyMCP23S17::setPortPolarity(uint8_t invertedPins, mcp_port port){
+    MCP_INSTRUMENT_API();
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_IPOL, mask, portBits(invertedPins, port));
+    writePair(MCP_IPOL, mask);
+}
+
+uint8_t MyMCP23S17::getPortPolarity(mcp_port port){
+    MCP_INSTRUMENT_API();
+    return portValue(MCP_IPOL, port);
+}
+
+void MyMCP23S17::setActiveLow(uint16_t activeLow){
+    MCP_INSTRUMENT_API();
+    regPairs[MCP_IPOL] = activeLow;
+    writePair(MCP_IPOL);
+}
 
 void MyMCP23S17::setIntMirror(uint8_t mirrored){
-    uint8_t ioConA = getIoCon(A);
-    uint8_t ioConB = getIoCon(B);
+    MCP_INSTRUMENT_API();
+    uint8_t ioConVal = getIoCon(A);
     if(mirrored){
-        ioConA |= (1<<MIRROR);
-        ioConB |= (1<<MIRROR);
+        ioConVal |= (1<<MIRROR);
     }
     else{
-        ioConA &= ~(1<<MIRROR);
-        ioConB &= ~(1<<MIRROR);
+        ioConVal &= ~(1<<MIRROR);
     }
-    write(IOCONA, ioConA);
-    write(IOCONB, ioConB);
+    setIoCon(ioConVal, A);
 }   
 
 uint8_t MyMCP23S17::getIntFlag(mcp_port port){
-    uint8_t value = 0;
-    if(port==A){
-        value = read(INTFA);
-    }
-    else if (port==B){ 
-        value = read(INTFB);
-    }
-    return value;
+    MCP_INSTRUMENT_API();
+    return read(mcpRegAddr(MCP_INTF, port));
 }
 
 bool MyMCP23S17::getPin(uint8_t pin, mcp_port port, bool useTransaction){
-    uint8_t result = 0;
-    if(port==A){
-        result = read(GPIOA, useTransaction);
-    }
-    else if(port==B){
-        result = read(GPIOB, useTransaction);
-    }
-    result &= (1<<pin);
-    if(result) return true;
-    else return false;  
+    MCP_INSTRUMENT_API();
+    return (read(mcpRegAddr(MCP_GPIO, port), useTransaction) >> pin) & 1;
 }
 
 uint8_t MyMCP23S17::getPort(mcp_port port, bool useTransaction){
-    uint8_t value = 0;
-    if(port==A){
-        value = read(GPIOA, useTransaction);
+    MCP_INSTRUMENT_API();
+    return read(mcpRegAddr(MCP_GPIO, port), useTransaction);
+}
+
+uint8_t MyMCP23S17::getIntCap(mcp_port port){
+    MCP_INSTRUMENT_API();
+    return read(mcpRegAddr(MCP_INTCAP, port));
+}
+
+uint16_t MyMCP23S17::getPorts(bool useTransaction){
+    MCP_INSTRUMENT_API();
+    return readRegPair(MCP_GPIO, useTransaction);
+}
+
+uint16_t MyMCP23S17::getIntCaps(){
+    MCP_INSTRUMENT_API();
+    return readRegPair(MCP_INTCAP);
+}
+
+uint16_t MyMCP23S17::getIntFlags(){
+    MCP_INSTRUMENT_API();
+    return readRegPair(MCP_INTF);
+}
+
+/* The clock of an ESP-IDF device is fixed when it is added, so an owned device is added again. 
+ * If that fails, it is added with the previous clock and false is returned: the SPIClass 
+ * doesn't own the host, the transfers must stay with the IDF driver. */
+bool MyMCP23S17::setSPIClockSpeed(unsigned long clock){
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    if(ownsIdfDevice){
+        uint32_t oldClock = idfClock;
+        if(!beginIdfDevice(idfHost, clock, idfCsSetup, idfCsHold)){
+            beginIdfDevice(idfHost, oldClock, idfCsSetup, idfCsHold);
+            return false;
+        }
     }
-    else if(port==B){
-        value = read(GPIOB, useTransaction);
+#endif
+    mySPISettings = SPISettings(clock, MSBFIRST, SPI_MODE0);
+    return true;
+}
+
+void MyMCP23S17::softReset(){
+    MCP_INSTRUMENT_API();
+    setShadowToResetValues();
+    writeImage(IODIRA, NUM_REGISTERS);
+}
+
+void MyMCP23S17::setRegPair(mcp_reg reg, uint16_t val, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    if(reg >= MCP_NUM_REGS || reg == MCP_INTF || reg == MCP_INTCAP){
+        return;
     }
-    return value;
+    if(reg == MCP_IOCON){
+        setIoCon(val, A);
+        return;
+    }
+    regPairs[mirrorOf(reg)] = val;
+    writePair(reg, 0xFFFF, useTransaction);
 }
 
-uint8_t MyMCP23S17::getIntCap(mcp_port port){
-    uint8_t value = 0;
-    if(port==A){
-        value = read(INTCAPA);
+uint16_t MyMCP23S17::readRegPair(mcp_reg reg, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    uint16_t val = 0;
+    readRegPairs(reg, reg, &val, useTransaction);
+    return val;
+}
+
+void MyMCP23S17::readRegPairs(mcp_reg first, mcp_reg last, uint16_t *pairs, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    uint8_t slots[NUM_REGISTERS] = {};
+    uint8_t count = last - first + 1;
+#ifdef MyMCP23S17_BANK1
+    MCP_BUS_GUARD(busLock);
+    readImage(mcpRegAddr(first, A), slots, count, useTransaction);
+    readImage(mcpRegAddr(first, B), slots, count, useTransaction);
+#else
+    readImage(mcpRegAddr(first, A), slots, 2 * count, useTransaction);
+#endif
+    for(uint8_t i=0; i<count; i++){
+        pairs[i] = slotPair(slots, (mcp_reg)(first + i));
     }
-    else if (port==B){
-        value = read(INTCAPB);
+}
+
+/* BANK=0: the frame starts at DEFVALA and wraps around to IODIRA after OLATB, so pull-ups and 
+ * latches are written before the directions, and GPINTEN comes last, after DEFVAL, INTCON and 
+ * IOCON: no interrupt is latched against the old comparison settings. BANK=1: no single frame 
+ * has this order for both ports, so DEFVALA...OLATA go first, then the whole image from 
+ * DEFVALB, which ends with GPINTENB. INTF / INTCAP are read only, the writes are ignored. */
+bool MyMCP23S17::apply(const MCP23S17Config &cfg, bool verify){
+    MCP_INSTRUMENT_API();
+    uint8_t ioConVal = cfg.ioCon & ~((1<<BANK) | (1<<SEQOP) | (1<<HAEN));
+    if(useHwAddress){
+        ioConVal |= (1<<HAEN);
+    }
+#ifdef MyMCP23S17_BANK1
+    ioConVal |= (1<<BANK);
+    const uint8_t first = DEFVALB;
+#else
+    const uint8_t first = DEFVALA;
+#endif
+
+    regPairs[MCP_IODIR]   = cfg.ioDir;
+    regPairs[MCP_IPOL]    = cfg.ipol;
+    regPairs[MCP_GPINTEN] = cfg.gpIntEn;
+    regPairs[MCP_DEFVAL]  = cfg.defVal;
+    regPairs[MCP_INTCON]  = cfg.intCon;
+    regPairs[MCP_GPPU]    = cfg.gppu;
+    regPairs[MCP_GPIO]    = cfg.olat;
+    regPairs[MCP_IOCON]   = (uint16_t)ioConVal << 8 | ioConVal;
+
+#ifdef MyMCP23S17_BANK1
+    writeImage(DEFVALA, MCP_OLAT - MCP_DEFVAL + 1);
+#endif
+    writeImage(first, NUM_REGISTERS);
+    if(!verify){
+        return true;
     }
-    return value;
+
+    uint8_t slots[NUM_REGISTERS] = {};
+    readImage(first, slots, NUM_REGISTERS);
+    for(uint8_t slot=0; slot<NUM_REGISTERS; slot++){
+        mcp_reg reg = (mcp_reg)(slot >> 1);
+        if(reg != MCP_INTF && reg != MCP_INTCAP && reg != MCP_GPIO && slots[slot] != portValue(reg, (mcp_port)(slot & 1))){
+            return false;
+        }
+    }
+    return true;
 }
 
-void MyMCP23S17::setSPIClockSpeed(unsigned long clock){
-    mySPISettings = SPISettings(clock, MSBFIRST, SPI_MODE0);
+MCP23S17Config MyMCP23S17::capture(){
+    MCP_INSTRUMENT_API();
+    uint8_t slots[NUM_REGISTERS] = {};
+    readImage(IODIRA, slots, NUM_REGISTERS);
+    return MCP23S17Config(slotPair(slots, MCP_IODIR), slotPair(slots, MCP_GPPU), slotPair(slots, MCP_OLAT), 
+        slotPair(slots, MCP_IPOL), slotPair(slots, MCP_GPINTEN), slotPair(slots, MCP_DEFVAL), 
+        slotPair(slots, MCP_INTCON), slots[2 * MCP_IOCON]);
 }
 
-void MyMCP23S17::softReset(){
+MCP23S17Config MyMCP23S17::getConfig(){
+    return MCP23S17Config(regPairs[MCP_IODIR], regPairs[MCP_GPPU], regPairs[MCP_GPIO], regPairs[MCP_IPOL], 
+        regPairs[MCP_GPINTEN], regPairs[MCP_DEFVAL], regPairs[MCP_INTCON], (uint8_t)regPairs[MCP_IOCON]);
+}
 
-    setPortMode(0, A);
-    setPortMode(0, B);
-    uint8_t reg = 0x02;
-    
-    _spi->beginTransaction(mySPISettings);
-    setCsPinLow();
-    uint16_t transBytes = ((SPI_Address<<1) << 8 | reg);
-    _spi->transfer16(transBytes); 
+void MyMCP23S17::resyncShadow(){
+    MCP_INSTRUMENT_API();
+    uint8_t slots[NUM_REGISTERS] = {};
+    readState(slots);
+    for(uint8_t reg=MCP_IODIR; reg<=MCP_GPPU; reg++){
+        regPairs[reg] = slotPair(slots, (mcp_reg)reg);
+    }
+    regPairs[MCP_IOCON] = slots[2 * MCP_IOCON] * 0x0101;
+    regPairs[MCP_GPIO] = slotPair(slots, MCP_OLAT);  // the latches, GPIO would return the pin levels
+}
 
-    for(int8_t i=0; i<18; i++){
-        _spi->transfer(0x00);
+void MyMCP23S17::setDeferred(bool on){
+    deferred = on;
+    if(!deferred){
+        commit();
     }
+}
 
-    setCsPinHigh();
-    _spi->endTransaction();
+bool MyMCP23S17::hasPendingWrites(){
+    for(uint8_t slot=0; slot<NUM_REGISTERS; slot++){
+        mcp_reg reg = (mcp_reg)(slot >> 1);
+        if(reg != MCP_INTF && reg != MCP_INTCAP && portValue(reg, (mcp_port)(slot & 1)) != deviceRegs[slot]){
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Writes all registers whose mirror differs from the last value written to (or read from)
+ * the device. A/B pairs are merged into one frame (BANK=0). The order avoids glitches: pull-ups 
+ * and output latches are set before the directions, interrupts are enabled last. */
+void MyMCP23S17::commit(bool useTransaction){
+    MCP_INSTRUMENT_API();
+    static constexpr mcp_reg order[] = {MCP_IOCON, MCP_GPPU, MCP_OLAT, MCP_IPOL, MCP_DEFVAL, MCP_INTCON, MCP_IODIR, MCP_GPINTEN};
+    bool begun = false;
+    MCP_BUS_GUARD(busLock);
+
+    for(uint8_t i=0; i<sizeof(order)/sizeof(order[0]); i++){
+        mcp_reg reg = order[i];
+        uint16_t mask = 0;
+        if(portValue(reg, A) != deviceRegs[2 * reg]){
+            mask |= 0x00FF;
+        }
+        if(reg != MCP_IOCON && portValue(reg, B) != deviceRegs[2 * reg + 1]){ // IOCONB == IOCONA
+            mask |= 0xFF00;
+        }
+        if(!mask){
+            continue;
+        }
+        if(useTransaction && !begun){
+            startBatch();
+            begun = true;
+        }
+        sendPair(reg, mask, false);
+    }
+
+    if(begun){
+        endBatch();
+    }
 }
 
 void MyMCP23S17::startBatch() {
+    MCP_INSTRUMENT_API();
+#ifdef MyMCP23S17_THREAD_SAFE
+    if(busLock){
+        busLock->lock();
+    }
+#endif
+    MCP_INSTRUMENT_TRANSACTION();
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    if(idfDevice){
+        spi_device_acquire_bus(idfDevice, portMAX_DELAY);
+        return;
+    }
+#endif
     _spi->beginTransaction(mySPISettings);
 }
 
 void MyMCP23S17::endBatch() {
+    MCP_INSTRUMENT_API();
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    if(idfDevice){
+        spi_device_release_bus(idfDevice);
+    }
+    else{
+        _spi->endTransaction();
+    }
+#else
     _spi->endTransaction();
+#endif
+#ifdef MyMCP23S17_THREAD_SAFE
+    if(busLock){
+        busLock->unlock();
+    }
+#endif
 }
 
 #ifdef DEBUG_MyMCP23S17   // see MyMCP23S17_config.h
 void MyMCP23S17::printAllRegisters(){
-    uint8_t reg = 0;
-    uint8_t regVal = 0;
+    MCP_INSTRUMENT_API();
+    static const char *const names[NUM_REGISTERS] = {
+        "IODIRA  ", "IODIRB  ", "IPOLA   ", "IPOLB   ", "GPINTENA", "GPINTENB",
+        "DEFVALA ", "DEFVALB ", "INTCONA ", "INTCONB ", "IOCONA  ", "IOCONB  ",
+        "GPPUA   ", "GPPUB   ", "INTFA   ", "INTFB   ", "INTCAPA ", "INTCAPB ",
+        "GPIOA   ", "GPIOB   ", "OLATA   ", "OLATB   "
+    };
+    uint8_t slots[NUM_REGISTERS] = {};
     char buf[20] = {};
+
+    readImage(IODIRA, slots, NUM_REGISTERS);
+    slots[2 * MCP_IODIR] = ~slots[2 * MCP_IODIR];
+    slots[2 * MCP_IODIR + 1] = ~slots[2 * MCP_IODIR + 1];
     
     Serial.println(F("Register status:"));
     
-    regVal = read(reg); regVal = ~regVal; reg++;
-    sprintf(buf, "IODIRA  : 0x%02X | 0b", regVal); 
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); regVal = ~regVal; reg++;
-    sprintf(buf, "IODIRB  : 0x%02X | 0b", regVal); 
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "IPOLA   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "IPOLB   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPINTENA: 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPINTENB: 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "DEFVALA : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "DEFVALB : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTCONA : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTCONB : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "IOCONA  : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "IOCONB  : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPPUA   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPPUB   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTFA   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTFB   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTCAPA : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "INTCAPB : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPIOA   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "GPIOB   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "OLATA   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
-    
-    regVal = read(reg); reg++;
-    sprintf(buf, "OLATB   : 0x%02X | 0b", regVal);
-    Serial.print(buf); printBin(regVal);
+    for(uint8_t slot=0; slot<NUM_REGISTERS; slot++){
+        sprintf(buf, "%s: 0x%02X | 0b", names[slot], slots[slot]); 
+        Serial.print(buf); printBin(slots[slot]);
+    }
 }
 
 void MyMCP23S17::printBin(uint8_t val){
@@ -652,145 +752,516 @@ void MyMCP23S17::printBin(uint8_t val){
 
 /* Private Functions */
 
+/* IOCONA and IOCONB address the same register, so one write covers both ports */
 void MyMCP23S17::setIoCon(uint8_t val, mcp_port port){
-    if(port==A){
-        write(IOCONA, val);
+    regPairs[MCP_IOCON] = (uint16_t)val << 8 | val;
+    writePair(MCP_IOCON, portBits(0xFF, port));
+}
+
+uint8_t MyMCP23S17::getIoCon(mcp_port port){
+    return portValue(MCP_IOCON, port);
+}
+
+void MyMCP23S17::setGpIntEn(uint8_t val, mcp_port port){
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_GPINTEN, mask, portBits(val, port));
+    writePair(MCP_GPINTEN, mask);
+}
+
+uint8_t MyMCP23S17::getGpIntEn(mcp_port port){
+    return portValue(MCP_GPINTEN, port);
+}
+
+void MyMCP23S17::setIntCon(uint8_t val, mcp_port port){
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_INTCON, mask, portBits(val, port));
+    writePair(MCP_INTCON, mask);
+}
+
+uint8_t MyMCP23S17::getIntCon(mcp_port port){
+    return portValue(MCP_INTCON, port);
+}
+
+void MyMCP23S17::setDefVal(uint8_t val, mcp_port port){
+    uint16_t mask = portBits(0xFF, port);
+    updatePair(MCP_DEFVAL, mask, portBits(val, port));
+    writePair(MCP_DEFVAL, mask);
+}
+
+uint8_t MyMCP23S17::getDefVal(mcp_port port){
+    return portValue(MCP_DEFVAL, port);
+}
+
+/* power-on / reset values of the registers, see datasheet table 3-3 */
+void MyMCP23S17::setShadowToResetValues(){
+    uint8_t ioConVal = useHwAddress ? (1<<HAEN) : 0;
+#ifdef MyMCP23S17_BANK1
+    ioConVal |= (1<<BANK);
+#endif
+    for(uint8_t reg=0; reg<MCP_NUM_REGS; reg++){
+        regPairs[reg] = 0;
     }
-    else if (port==B){
-        write(IOCONB, val);
+    regPairs[MCP_IODIR] = 0xFFFF;
+    regPairs[MCP_IOCON] = (uint16_t)ioConVal << 8 | ioConVal;
+    for(uint8_t slot=0; slot<NUM_REGISTERS; slot++){
+        deviceRegs[slot] = portValue((mcp_reg)(slot >> 1), (mcp_port)(slot & 1));
     }
 }
 
-uint8_t MyMCP23S17::getIoCon(mcp_port port){
-    if(port==A){
-        return read(IOCONA);
+void MyMCP23S17::write(uint8_t reg, uint8_t val, bool useTransaction){
+    sendRegs(reg, &val, 1, useTransaction);
+}
+
+void MyMCP23S17::write(uint8_t reg, uint8_t valA, uint8_t valB, bool useTransaction){
+    uint8_t vals[] = {valA, valB};
+    sendRegs(reg, vals, sizeof(vals), useTransaction);
+}
+
+uint8_t MyMCP23S17::read(uint8_t reg, bool useTransaction){
+    uint8_t regVal = 0;
+    readRegs(reg, &regVal, 1, useTransaction);
+    return regVal;
+}
+
+/* Sequential access: the address pointer of the device increments with every byte 
+ * (IOCON.SEQOP = 0), so count registers are written / read in one CS frame. The written 
+ * registers are taken over into the mirror, so commit() does not write the old values back. */
+void MyMCP23S17::writeRegs(uint8_t reg, const uint8_t *vals, uint8_t count, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    MCP_BUS_GUARD(busLock);
+    uint8_t addr = reg;
+    for(uint8_t i=0; i<count && i<NUM_REGISTERS; i++, addr=nextAddr(addr)){
+        noteMirrorReg(addr, vals[i]);
+    }
+    sendRegs(reg, vals, count, useTransaction);
+}
+
+/* writeRegs() without the mirror, for frames built from the mirror (or the device image) */
+void MyMCP23S17::sendRegs(uint8_t reg, const uint8_t *vals, uint8_t count, bool useTransaction){
+    uint8_t buffer[MCP23S17_MAX_FRAME];
+    uint8_t len = encodeFrame(buffer, false, reg, vals, count);
+    MCP_BUS_GUARD(busLock);
+    noteWrittenFrame(buffer, len);  // the buffer is overwritten by the transfer
+    transferFrame(buffer, len, useTransaction);
+}
+
+void MyMCP23S17::readRegs(uint8_t reg, uint8_t *vals, uint8_t count, bool useTransaction){
+    MCP_INSTRUMENT_API();
+    uint8_t buffer[MCP23S17_MAX_FRAME];
+    uint8_t len = encodeFrame(buffer, true, reg, nullptr, count);
+    MCP_BUS_GUARD(busLock);
+    transferFrame(buffer, len, useTransaction);
+    memcpy(vals, &buffer[2], len - 2);
+    noteReadFrame(reg, &buffer[2], len - 2);
+}
+
+/* The only place where frames are built, used by the blocking and the asynchronous path. 
+ * vals == nullptr (or a read) sends zeros. Returns the frame length. */
+uint8_t MyMCP23S17::encodeFrame(uint8_t *buf, bool isRead, uint8_t reg, const uint8_t *vals, uint8_t count){
+    if(count > NUM_REGISTERS){
+        count = NUM_REGISTERS;
+    }
+    buf[0] = isRead ? ((SPI_Address<<1) | SPI_READ) : (SPI_Address<<1);
+    buf[1] = reg;
+    if(vals && !isRead){
+        memcpy(&buf[2], vals, count);
     }
     else{
-        return read(IOCONB);
+        memset(&buf[2], 0, count);
     }
+    return count + 2;
 }
 
+/* Transfers a frame full duplex: buf is sent and overwritten with the received bytes */
+void MyMCP23S17::transferFrame(uint8_t *buf, uint8_t len, bool useTransaction){
+    MCP_BUS_GUARD(busLock);
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    if(idfDevice){
+        (void)useTransaction;
+        finishAsync();  // polling transfers must not overtake queued ones
+        alignas(4) uint8_t rx[MCP23S17_MAX_FRAME];
+        spi_transaction_t t = {};
+        t.length = len * 8;
+        t.tx_buffer = buf;
+        t.rx_buffer = rx;
+        MCP_INSTRUMENT_START();
+        spi_device_polling_transmit(idfDevice, &t);
+        MCP_INSTRUMENT_FRAME(len);
+        memcpy(buf, rx, len);
+        return;
+    }
+#endif
+    MCP_INSTRUMENT_START();
+    if (useTransaction) {
+        MCP_INSTRUMENT_TRANSACTION();
+        _spi->beginTransaction(mySPISettings);
+    }
 
-void MyMCP23S17::setGpIntEn(uint8_t val, mcp_port port){
-    if(port==A){
-        write(GPINTENA, val);
+    setCsPinLow();
+    _spi->transfer(buf, len);
+    setCsPinHigh();
+
+    if (useTransaction) {
+        _spi->endTransaction();
     }
-    else if (port==B){
-        write(GPINTENB, val);  
+    MCP_INSTRUMENT_FRAME(len);
+}
+
+void MyMCP23S17::noteWrittenFrame(const uint8_t *buf, uint8_t len){
+    uint8_t addr = buf[1];
+    for(uint8_t i=2; i<len; i++){
+        noteDeviceReg(addr, buf[i]);
+        addr = nextAddr(addr);
     }
 }
 
+void MyMCP23S17::noteReadFrame(uint8_t reg, const uint8_t *vals, uint8_t count){
+    for(uint8_t i=0; i<count; i++){
+        if(reg != GPIOA && reg != GPIOB){ // GPIO returns the pin levels, not the latch
+            noteDeviceReg(reg, vals[i]);
+        }
+        reg = nextAddr(reg);
+    }
+}
 
-uint8_t MyMCP23S17::getGpIntEn(mcp_port port){
-    if(port==A){
-        return read(GPINTENA);
+/* Asynchronous transfers */
+
+void MyMCP23S17::prepareWrite(MCP23S17Job &job, uint8_t reg, const uint8_t *vals, uint8_t count){
+    job.len = encodeFrame(job.tx, false, reg, vals, count);
+    job.isRead = false;
+}
+
+void MyMCP23S17::prepareRead(MCP23S17Job &job, uint8_t reg, uint8_t count){
+    job.len = encodeFrame(job.tx, true, reg, nullptr, count);
+    job.isRead = true;
+}
+
+bool MyMCP23S17::submitAsync(MCP23S17Job &job, mcp_job_callback cb, void *arg){
+    MCP_INSTRUMENT_API();
+    if(job.len < 2){
+        return false;
     }
-    else{
-        return read(GPINTENB);
+    job.dev = this;
+    job.callback = cb;
+    job.arg = arg;
+    job.done = false;
+
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    if(idfDevice){
+        MCP_BUS_GUARD(busLock);
+        job.trans = spi_transaction_t{};
+        job.trans.length = job.len * 8;
+        job.trans.tx_buffer = job.tx;
+        job.trans.rx_buffer = job.rx;
+        job.trans.user = &job;
+        if(spi_device_queue_trans(idfDevice, &job.trans, portMAX_DELAY) != ESP_OK){
+            return false;
+        }
+        MCP_INSTRUMENT_QUEUED(job.len);
+        asyncPending++;
+        return true;
     }
+#endif
+    /* synchronous fallback, the same frame through the blocking path */
+    memcpy(job.rx, job.tx, job.len);
+    transferFrame(job.rx, job.len, true);
+    completeJob(job);
+    return true;
 }
 
+#ifndef MyMCP23S17_BANK1
+bool MyMCP23S17::setPortsAsync(MCP23S17Job &job, uint8_t portLevelA, uint8_t portLevelB, mcp_job_callback cb, void *arg){
+    MCP_INSTRUMENT_API();
+    regPairs[MCP_GPIO] = (uint16_t)portLevelB << 8 | portLevelA;
+    uint8_t vals[] = {portLevelA, portLevelB};
+    prepareWrite(job, GPIOA, vals, sizeof(vals));
+    return submitAsync(job, cb, arg);
+}
 
-void MyMCP23S17::setIntCon(uint8_t val, mcp_port port){
-    if(port==A){
-        write(INTCONA, val);
-    }
-    else if (port==B){
-        write(INTCONB, val);
+bool MyMCP23S17::getPortsAsync(MCP23S17Job &job, mcp_job_callback cb, void *arg){
+    MCP_INSTRUMENT_API();
+    prepareRead(job, GPIOA, 2);
+    return submitAsync(job, cb, arg);
+}
+#endif // MyMCP23S17_BANK1
+
+/* Completes finished asynchronous jobs and calls their callbacks (in the calling task) */
+void MyMCP23S17::pollAsync(){
+    MCP_INSTRUMENT_API();
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    MCP_BUS_GUARD(busLock);
+    spi_transaction_t *t;
+    while(asyncPending && spi_device_get_trans_result(idfDevice, &t, 0) == ESP_OK){
+        asyncPending--;
+        completeJob(*static_cast<MCP23S17Job *>(t->user));
     }
+#endif
 }
 
-uint8_t MyMCP23S17::getIntCon(mcp_port port){
-    if(port==A){
-        return read(INTCONA);
+void MyMCP23S17::finishAsync(){
+    MCP_INSTRUMENT_API();
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    MCP_BUS_GUARD(busLock);
+    spi_transaction_t *t;
+    while(asyncPending && spi_device_get_trans_result(idfDevice, &t, portMAX_DELAY) == ESP_OK){
+        asyncPending--;
+        completeJob(*static_cast<MCP23S17Job *>(t->user));
     }
-    else{
-        return read(INTCONB);
+#endif
+}
+
+#ifdef MyMCP23S17_HAS_IDF_SPI
+/* The handle has to be added with spi_bus_add_device() with spics_io_num = csPin, so the 
+ * SPI peripheral drives CS. All transfers of this object then use the ESP-IDF driver. */
+void MyMCP23S17::attachIdfDevice(spi_device_handle_t handle){
+    endIdfDevice();
+    idfDevice = handle;
+}
+
+/* Initializes an SPI host for the ESP-IDF driver. The host must not be used by an Arduino 
+ * SPIClass at the same time. */
+bool MyMCP23S17::beginIdfBus(spi_host_device_t host, int sck, int miso, int mosi){
+    spi_bus_config_t busCfg = {};
+    busCfg.mosi_io_num = mosi;
+    busCfg.miso_io_num = miso;
+    busCfg.sclk_io_num = sck;
+    busCfg.quadwp_io_num = -1;
+    busCfg.quadhd_io_num = -1;
+    busCfg.max_transfer_sz = MCP23S17_MAX_FRAME;
+    esp_err_t err = spi_bus_initialize(host, &busCfg, SPI_DMA_CH_AUTO);
+    return err == ESP_OK || err == ESP_ERR_INVALID_STATE; // already initialized
+}
+
+/* Adds this expander as a device with hardware CS to an initialized SPI host. CS is driven 
+ * by the SPI peripheral, csSetup / csHold are the CS lead / lag times in SPI clock cycles. */
+bool MyMCP23S17::beginIdfDevice(spi_host_device_t host, uint32_t clock, uint8_t csSetup, uint8_t csHold){
+    endIdfDevice();
+
+    spi_device_interface_config_t devCfg = {};
+    devCfg.mode = 0;
+    devCfg.clock_speed_hz = clock;
+    devCfg.spics_io_num = csPin;
+    devCfg.cs_ena_pretrans = csSetup;
+    devCfg.cs_ena_posttrans = csHold;
+    devCfg.queue_size = IDF_QUEUE_SIZE;
+    if(spi_bus_add_device(host, &devCfg, &idfDevice) != ESP_OK){
+        idfDevice = nullptr;
+        return false;
     }
+    idfHost = host;
+    idfClock = clock;
+    idfCsSetup = csSetup;
+    idfCsHold = csHold;
+    ownsIdfDevice = true;
+    return true;
 }
 
-void MyMCP23S17::setDefVal(uint8_t val, mcp_port port){
-    if(port==A){
-        write(DEFVALA, val);
+/* Back to the Arduino SPIClass with CS by GPIO */
+void MyMCP23S17::endIdfDevice(){
+    if(!idfDevice){
+        return;
     }
-    else if (port==B){
-        write(DEFVALB, val);    
+    finishAsync();
+    if(ownsIdfDevice){
+        spi_bus_remove_device(idfDevice);
     }
+    idfDevice = nullptr;
+    ownsIdfDevice = false;
+    setCsPinMode();
+    setCsPinHigh();
 }
+#endif
 
-uint8_t MyMCP23S17::getDefVal(mcp_port port){
-    if(port==A){
-        return read(DEFVALA);
+bool MyMCP23S17::usesIdfDevice() const {
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    return idfDevice != nullptr;
+#else
+    return false;
+#endif
+}
+
+void MyMCP23S17::completeJob(MCP23S17Job &job){
+    if(job.isRead){
+        noteReadFrame(job.tx[1], &job.rx[2], job.len - 2);
     }
     else{
-        return read(DEFVALB);  
+        noteWrittenFrame(job.tx, job.len);
+    }
+    job.done = true;
+    if(job.callback){
+        job.callback(job, job.arg);
     }
 }
 
-void MyMCP23S17::write(uint8_t reg, uint8_t val, bool useTransaction){
-    
-    if (useTransaction) {
-        _spi->beginTransaction(mySPISettings);
+void MCP23S17Job::wait(){
+    while(!done && dev){
+        dev->pollAsync();
     }
-    
-    setCsPinLow();
-
-    uint8_t buffer[] = {OPCODE_WRITE, reg, val};
-    _spi->transfer(buffer, sizeof(buffer));
-
-    setCsPinHigh();
+}
 
-    if (useTransaction) {
-        _spi->endTransaction();
+/* mode of the pins in mask: OUTPUT, INPUT or INPUT_PULLUP */
+void MyMCP23S17::updatePinModes(uint16_t mask, uint8_t mode){
+    if(mode==OUTPUT){
+        MCP_SHADOW_CLR(regPairs[MCP_IODIR], mask);
+        MCP_SHADOW_CLR(regPairs[MCP_GPPU], mask);
+    }
+    else if(mode==INPUT){
+        MCP_SHADOW_SET(regPairs[MCP_IODIR], mask);
+        MCP_SHADOW_CLR(regPairs[MCP_GPPU], mask);
+    }
+    else if(mode==INPUT_PULLUP){
+        MCP_SHADOW_SET(regPairs[MCP_IODIR], mask);
+        MCP_SHADOW_SET(regPairs[MCP_GPPU], mask);
     }
 }
 
-void MyMCP23S17::write(uint8_t reg, uint8_t valA, uint8_t valB, bool useTransaction){
-    
-    if (useTransaction) {
-        _spi->beginTransaction(mySPISettings);
+/* Writes the pairs first...last from the mirror (or leaves it to commit() in deferred mode). 
+ * BANK=0: one frame, BANK=1: one frame per port in mask. */
+void MyMCP23S17::writePairs(mcp_reg first, mcp_reg last, uint16_t mask, bool useTransaction){
+    if(deferred){
+        return;
     }
+    uint8_t count = last - first + 1;
+#ifdef MyMCP23S17_BANK1
+    if(mask & 0x00FF){
+        writeImage(mcpRegAddr(first, A), count, useTransaction);
+    }
+    if(mask & 0xFF00){
+        writeImage(mcpRegAddr(first, B), count, useTransaction);
+    }
+#else
+    (void)mask;
+    writeImage(mcpRegAddr(first, A), 2 * count, useTransaction);
+#endif
+}
 
-    setCsPinLow();
+void MyMCP23S17::sendPair(mcp_reg reg, uint16_t mask, bool useTransaction){
+    MCP_BUS_GUARD(busLock);
+    bool portA = mask & 0x00FF;
+    bool portB = (mask & 0xFF00) && !(portA && reg == MCP_IOCON); // IOCONB == IOCONA
+#ifndef MyMCP23S17_BANK1
+    if(portA && portB){
+        write(mcpRegAddr(reg, A), portValue(reg, A), portValue(reg, B), useTransaction);
+        return;
+    }
+#endif
+    if(portA){
+        write(mcpRegAddr(reg, A), portValue(reg, A), useTransaction);
+    }
+    if(portB){
+        write(mcpRegAddr(reg, B), portValue(reg, B), useTransaction);
+    }
+}
 
-    uint8_t buffer[] = {OPCODE_WRITE, reg, valA, valB};
-    _spi->transfer(buffer, sizeof(buffer));
+void MyMCP23S17::writeImage(uint8_t addr, uint8_t count, bool useTransaction){
+    uint8_t vals[NUM_REGISTERS];
+    if(count > NUM_REGISTERS){
+        count = NUM_REGISTERS;
+    }
+    MCP_BUS_GUARD(busLock);
+    for(uint8_t i=0, a=addr; i<count; i++, a=nextAddr(a)){
+        vals[i] = shadowValue(a);
+    }
+    sendRegs(addr, vals, count, useTransaction);
+}
 
-    setCsPinHigh();
+void MyMCP23S17::readState(uint8_t *slots, bool useTransaction){
+#ifdef MyMCP23S17_BANK1
+    MCP_BUS_GUARD(busLock);
+    readImage(OLATA, slots, NUM_STATE_REGS, useTransaction);
+    readImage(OLATB, slots, NUM_STATE_REGS, useTransaction);
+#else
+    readImage(OLATA, slots, 2 * NUM_STATE_REGS, useTransaction);
+#endif
+}
 
-    if (useTransaction) {
-        _spi->endTransaction();
+void MyMCP23S17::readImage(uint8_t addr, uint8_t *slots, uint8_t count, bool useTransaction){
+    uint8_t vals[NUM_REGISTERS];
+    if(count > NUM_REGISTERS){
+        count = NUM_REGISTERS;
+    }
+    readRegs(addr, vals, count, useTransaction);
+    for(uint8_t i=0, a=addr; i<count; i++, a=nextAddr(a)){
+        slots[slotOf(a)] = vals[i];
     }
 }
 
-uint8_t MyMCP23S17::read(uint8_t reg, bool useTransaction){
-
-    uint8_t regVal;
-    
-    if (useTransaction) {
-        _spi->beginTransaction(mySPISettings);
+/* slot of an address, 0xFF if there is no such register */
+uint8_t MyMCP23S17::slotOf(uint8_t addr) const {
+#ifdef MyMCP23S17_BANK1
+    uint8_t reg = addr & 0x0F;
+    if(addr >= 0x20 || reg >= MCP_NUM_REGS){
+        return 0xFF;
     }
+    return (reg << 1) | ((addr >> 4) & 1);
+#else
+    return addr < NUM_REGISTERS ? addr : 0xFF;
+#endif
+}
 
-    setCsPinLow();
+/* Address following addr in a sequential frame. BANK=1: OLATA is followed by IODIRB, 
+ * OLATB by IODIRA. */
+uint8_t MyMCP23S17::nextAddr(uint8_t addr) const {
+#ifdef MyMCP23S17_BANK1
+    if((addr & 0x0F) >= MCP_OLAT){
+        return (addr & 0x10) ? mcpRegAddr(MCP_IODIR, A) : mcpRegAddr(MCP_IODIR, B);
+    }
+    return addr + 1;
+#else
+    return (addr + 1) % NUM_REGISTERS;
+#endif
+}
 
-    uint8_t buffer[] = {0b01000001, reg};
-    _spi->transfer(buffer, sizeof(buffer));
-    // uint16_t transBytes = (((SPI_Address<<1) | SPI_READ) << 8 | reg);
-    // _spi->transfer16(transBytes); 
-    regVal = _spi->transfer(0x00);
+uint8_t MyMCP23S17::shadowValue(uint8_t addr){
+    if(!isWritable(addr)){
+        return 0;  // INTF, INTCAP: read only
+    }
+    uint8_t slot = slotOf(addr);
+    return portValue((mcp_reg)(slot >> 1), (mcp_port)(slot & 1));
+}
 
-    setCsPinHigh();
+bool MyMCP23S17::isWritable(uint8_t addr){
+    uint8_t slot = slotOf(addr);
+    return slot < NUM_REGISTERS && (slot >> 1) != MCP_INTF && (slot >> 1) != MCP_INTCAP;
+}
 
-    if (useTransaction) {
-        _spi->endTransaction();
+void MyMCP23S17::noteMirrorReg(uint8_t addr, uint8_t val){
+    if(!isWritable(addr)){
+        return;
+    }
+    uint8_t slot = slotOf(addr);
+    mcp_reg reg = mirrorOf((mcp_reg)(slot >> 1));
+    if(reg == MCP_IOCON){
+        regPairs[MCP_IOCON] = (uint16_t)val << 8 | val;
+        return;
     }
+    mcp_port port = (mcp_port)(slot & 1);
+    updatePair(reg, portBits(0xFF, port), portBits(val, port));
+}
 
-    return regVal;
+/* Keeps track of the register values in the device, GPIO and OLAT as well as IOCONA and 
+ * IOCONB are the same registers */
+void MyMCP23S17::noteDeviceReg(uint8_t addr, uint8_t val){
+    if(!isWritable(addr)){
+        return;
+    }
+    uint8_t slot = slotOf(addr);
+    uint8_t reg = slot >> 1;
+    uint8_t port = slot & 1;
+    if(reg == MCP_IOCON){
+        deviceRegs[2 * MCP_IOCON] = deviceRegs[2 * MCP_IOCON + 1] = val;
+    }
+    else if(reg == MCP_GPIO || reg == MCP_OLAT){
+        deviceRegs[2 * MCP_GPIO + port] = deviceRegs[2 * MCP_OLAT + port] = val;
+    }
+    else{
+        deviceRegs[slot] = val;
+    }
 }
 
 void MyMCP23S17::setCsPinMode() {
 
-#ifdef USE_HW_CS
+#ifdef MyMCP23S17_USE_HW_CS
 return;
 #endif
 
@@ -798,6 +1269,8 @@ pinMode(csPin, OUTPUT);
 
 }
 
+/* GPIO 0...31 are in GPIO_OUT, GPIO 32... in GPIO_OUT1 (not on variants with up to 32 GPIOs). 
+ * beginBus() has checked csPin. */
 void MyMCP23S17::setCsPinLow() {
 
 #ifdef MyMCP23S17_USE_HW_CS
@@ -805,6 +1278,12 @@ return;
 #endif
 
 #ifdef MyMCP23S17_USE_ESP32_REG_WRITE
+#ifdef GPIO_OUT1_W1TC_REG
+    if(csPin >= 32){
+        REG_WRITE(GPIO_OUT1_W1TC_REG, BIT(csPin - 32));
+        return;
+    }
+#endif
     REG_WRITE(GPIO_OUT_W1TC_REG, BIT(csPin));
 #else
     digitalWrite(csPin, LOW);
@@ -818,6 +1297,12 @@ return;
 #endif
 
 #ifdef MyMCP23S17_USE_ESP32_REG_WRITE
+#ifdef GPIO_OUT1_W1TS_REG
+    if(csPin >= 32){
+        REG_WRITE(GPIO_OUT1_W1TS_REG, BIT(csPin - 32));
+        return;
+    }
+#endif
     REG_WRITE(GPIO_OUT_W1TS_REG, BIT(csPin));
 #else
     digitalWrite(csPin, HIGH);
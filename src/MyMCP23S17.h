@@ -26,37 +26,169 @@ https://wolles-elektronikkiste.de/portexpander-mcp23017       (German)
 #endif
 #include "MyMCP23S17_config.h"
 #include <SPI.h>
+#ifdef MyMCP23S17_HAS_IDF_SPI
+#include "driver/spi_master.h"
+#endif
+#if defined(MyMCP23S17_USE_ESP32_REG_WRITE) && defined(ARDUINO_ARCH_ESP32)
+#include "driver/gpio.h"   // GPIO_IS_VALID_OUTPUT_GPIO()
+#endif
+#ifdef MyMCP23S17_THREAD_SAFE
+#include "MyMCP23S17_Lock.h"
+#endif
+#include "MyMCP23S17_Instrument.h"
 
 typedef enum MCP_PORT {A, B} mcp_port;
 typedef enum MCP_ENABLE {OFF, ON} mcp_enable;
 
+/* Register pairs, in the order of the IOCON.BANK=1 layout. As 16 bit value port A is the low byte, 
+ * port B the high byte. */
+typedef enum MCP_REG {MCP_IODIR, MCP_IPOL, MCP_GPINTEN, MCP_DEFVAL, MCP_INTCON, MCP_IOCON, MCP_GPPU, 
+    MCP_INTF, MCP_INTCAP, MCP_GPIO, MCP_OLAT, MCP_NUM_REGS} mcp_reg;
+
+/* SPI address of a register. BANK=0 (default): the A and B register of a pair are neighbours, 
+ * BANK=1 (MyMCP23S17_BANK1, see MyMCP23S17_config.h): one block of registers per port. */
+constexpr uint8_t mcpRegAddr(mcp_reg reg, mcp_port port) {
+#ifdef MyMCP23S17_BANK1
+    return (port << 4) | reg;
+#else
+    return (reg << 1) | port;
+#endif
+}
+
+/* Bit changes of the register mirror and the bus lock of the SPI frames, see MyMCP23S17_THREAD_SAFE */
+#ifdef MyMCP23S17_THREAD_SAFE
+#define MCP_SHADOW_SET(var, mask) __atomic_fetch_or(&(var), (__typeof__(var))(mask), __ATOMIC_RELAXED)
+#define MCP_SHADOW_CLR(var, mask) __atomic_fetch_and(&(var), (__typeof__(var))~(mask), __ATOMIC_RELAXED)
+#define MCP_SHADOW_TGL(var, mask) __atomic_fetch_xor(&(var), (__typeof__(var))(mask), __ATOMIC_RELAXED)
+#define MCP_BUS_GUARD(lock) MCP23S17LockGuard busGuard(lock)
+#else
+#define MCP_SHADOW_SET(var, mask) ((var) |= (mask))
+#define MCP_SHADOW_CLR(var, mask) ((var) &= ~(mask))
+#define MCP_SHADOW_TGL(var, mask) ((var) ^= (mask))
+#define MCP_BUS_GUARD(lock)
+#endif
+
+static constexpr uint8_t MCP23S17_MAX_FRAME = 24; // opcode + register + 22 registers
+
+class MyMCP23S17;
+class MCP23S17Job;
+typedef void (*mcp_job_callback)(MCP23S17Job &job, void *arg);
+
+/* A frame for asynchronous transfers. The job must stay valid (and, with DMA, in internal RAM) 
+ * until it is done. */
+class MCP23S17Job{
+
+    friend class MyMCP23S17;
+    friend class MCP23S17Sequencer;
+
+    public:
+        MCP23S17Job() : tx{}, rx{}, len{0}, isRead{false}, done{true}, callback{nullptr}, arg{nullptr}, dev{nullptr} {}
+
+        bool isDone() const { return done; }
+        void wait();
+
+        /* results of a read job: i-th register read, getPorts() for getPortsAsync() */
+        uint8_t getReg(uint8_t i) const { return rx[2 + i]; }
+        uint16_t getPorts() const { return (uint16_t)rx[3] << 8 | rx[2]; }
+
+    protected:
+        alignas(4) uint8_t tx[MCP23S17_MAX_FRAME];
+        alignas(4) uint8_t rx[MCP23S17_MAX_FRAME];
+        uint8_t len;
+        bool isRead;
+        volatile bool done;
+        mcp_job_callback callback;
+        void *arg;
+        MyMCP23S17 *dev;
+#ifdef MyMCP23S17_HAS_IDF_SPI
+        spi_transaction_t trans;
+#endif
+};
+
+/* Register set of a device as value type, port A in the low byte, port B in the high byte. 
+ * constexpr, so fixed configurations can be built at compile time and stored in flash:
+ *   static constexpr MCP23S17Config cfg = MCP23S17Config().withOutputs(0x00FF).withPullUps(0xFF00);
+ * Applied with MyMCP23S17::apply() in one frame. */
+struct MCP23S17Config {
+    uint16_t ioDir;    // 1 = input
+    uint16_t ipol;
+    uint16_t gpIntEn;
+    uint16_t defVal;
+    uint16_t intCon;
+    uint16_t gppu;
+    uint16_t olat;
+    uint8_t ioCon;     // BANK and SEQOP are ignored, HAEN is set if the device uses hardware addressing
+
+    constexpr MCP23S17Config(uint16_t dir = 0xFFFF, uint16_t pu = 0, uint16_t lat = 0, uint16_t pol = 0, 
+        uint16_t intEn = 0, uint16_t defV = 0, uint16_t intC = 0, uint8_t con = 0) : 
+        ioDir{dir}, ipol{pol}, gpIntEn{intEn}, defVal{defV}, intCon{intC}, gppu{pu}, olat{lat}, ioCon{con} {}
+
+    constexpr MCP23S17Config withOutputs(uint16_t pins) const {
+        return MCP23S17Config((uint16_t)(ioDir & ~pins), (uint16_t)(gppu & ~pins), olat, ipol, gpIntEn, defVal, intCon, ioCon);
+    }
+    constexpr MCP23S17Config withPullUps(uint16_t pins) const {
+        return MCP23S17Config((uint16_t)(ioDir | pins), (uint16_t)(gppu | pins), olat, ipol, gpIntEn, defVal, intCon, ioCon);
+    }
+    constexpr MCP23S17Config withLevels(uint16_t levels) const {
+        return MCP23S17Config(ioDir, gppu, levels, ipol, gpIntEn, defVal, intCon, ioCon);
+    }
+    constexpr MCP23S17Config withPolarity(uint16_t inverted) const {
+        return MCP23S17Config(ioDir, gppu, olat, inverted, gpIntEn, defVal, intCon, ioCon);
+    }
+    constexpr MCP23S17Config withInterruptOnChange(uint16_t pins) const {
+        return MCP23S17Config((uint16_t)(ioDir | pins), gppu, olat, ipol, (uint16_t)(gpIntEn | pins), defVal, 
+            (uint16_t)(intCon & ~pins), ioCon);
+    }
+    constexpr MCP23S17Config withInterruptOnDefVal(uint16_t pins, uint16_t defLevels) const {
+        return MCP23S17Config((uint16_t)(ioDir | pins), gppu, olat, ipol, (uint16_t)(gpIntEn | pins), 
+            (uint16_t)((defVal & ~pins) | (defLevels & pins)), (uint16_t)(intCon | pins), ioCon);
+    }
+    constexpr MCP23S17Config withIoCon(uint8_t con) const {
+        return MCP23S17Config(ioDir, gppu, olat, ipol, gpIntEn, defVal, intCon, con);
+    }
+};
+
 class MyMCP23S17{
 
+    friend class MCP23S17Bus;
+    friend class MCP23S17Sequencer;
+    friend class MCP23S17Health;
+
     public:
 
-        /* Registers */
-        static constexpr uint8_t IODIRA  {0x00};  
-        static constexpr uint8_t IODIRB  {0x01}; 
-        static constexpr uint8_t IOCONA  {0x0A}; 
-        static constexpr uint8_t IOCONB  {0x0B};
-        static constexpr uint8_t INTCAPA {0x10};
-        static constexpr uint8_t INTCAPB {0x11};
-        static constexpr uint8_t INTCONA {0x08};
-        static constexpr uint8_t INTCONB {0x09};
-        static constexpr uint8_t INTFA   {0x0E};  
-        static constexpr uint8_t INTFB   {0x0F};
-        static constexpr uint8_t GPINTENA{0x04};
-        static constexpr uint8_t GPINTENB{0x05};
-        static constexpr uint8_t DEFVALA {0x06};
-        static constexpr uint8_t DEFVALB {0x07};
-        static constexpr uint8_t IPOLA   {0x02}; 
-        static constexpr uint8_t GPIOA   {0x12};  
-        static constexpr uint8_t GPIOB   {0x13};
+        /* Registers (SPI addresses in the selected IOCON.BANK layout) */
+        static constexpr uint8_t IODIRA  {mcpRegAddr(MCP_IODIR, A)};  
+        static constexpr uint8_t IODIRB  {mcpRegAddr(MCP_IODIR, B)}; 
+        static constexpr uint8_t IOCONA  {mcpRegAddr(MCP_IOCON, A)}; 
+        static constexpr uint8_t IOCONB  {mcpRegAddr(MCP_IOCON, B)};
+        static constexpr uint8_t INTCAPA {mcpRegAddr(MCP_INTCAP, A)};
+        static constexpr uint8_t INTCAPB {mcpRegAddr(MCP_INTCAP, B)};
+        static constexpr uint8_t INTCONA {mcpRegAddr(MCP_INTCON, A)};
+        static constexpr uint8_t INTCONB {mcpRegAddr(MCP_INTCON, B)};
+        static constexpr uint8_t INTFA   {mcpRegAddr(MCP_INTF, A)};  
+        static constexpr uint8_t INTFB   {mcpRegAddr(MCP_INTF, B)};
+        static constexpr uint8_t GPINTENA{mcpRegAddr(MCP_GPINTEN, A)};
+        static constexpr uint8_t GPINTENB{mcpRegAddr(MCP_GPINTEN, B)};
+        static constexpr uint8_t DEFVALA {mcpRegAddr(MCP_DEFVAL, A)};
+        static constexpr uint8_t DEFVALB {mcpRegAddr(MCP_DEFVAL, B)};
+        static constexpr uint8_t IPOLA   {mcpRegAddr(MCP_IPOL, A)}; 
+        static constexpr uint8_t IPOLB   {mcpRegAddr(MCP_IPOL, B)}; 
+        static constexpr uint8_t GPIOA   {mcpRegAddr(MCP_GPIO, A)};  
+        static constexpr uint8_t GPIOB   {mcpRegAddr(MCP_GPIO, B)};
         static constexpr uint8_t INTPOL  {0x01};  
         static constexpr uint8_t INTODR  {0x02};
         static constexpr uint8_t MIRROR  {0x06};  
-        static constexpr uint8_t GPPUA   {0x0C};
-        static constexpr uint8_t GPPUB   {0x0D};
+        static constexpr uint8_t HAEN    {0x03};
+        static constexpr uint8_t SEQOP   {0x05};
+        static constexpr uint8_t BANK    {0x07};
+        static constexpr uint8_t GPPUA   {mcpRegAddr(MCP_GPPU, A)};
+        static constexpr uint8_t GPPUB   {mcpRegAddr(MCP_GPPU, B)};
+        static constexpr uint8_t OLATA   {mcpRegAddr(MCP_OLAT, A)};
+        static constexpr uint8_t OLATB   {mcpRegAddr(MCP_OLAT, B)};
+        static constexpr uint8_t NUM_REGISTERS {0x16};
+        /* IOCON in the two layouts, to switch between them */
+        static constexpr uint8_t IOCON_BANK0 {0x0A};
+        static constexpr uint8_t IOCON_BANK1 {0x05};
         static constexpr uint8_t SPI_READ{0x01};
 
         static constexpr uint32_t SPI_CLOCKSPEED = 10000000;
@@ -65,11 +197,19 @@ class MyMCP23S17{
         static constexpr uint8_t OPCODE_READ = 0b01000001;
 
         /* constructors */
-        MyMCP23S17(SPIClass *s, uint8_t cs, uint8_t rp = 99) : _spi{s}, SPI_Address{0x20}, resetPin{rp}, csPin{cs} {}
+        MyMCP23S17(SPIClass *s, uint8_t cs, uint8_t rp = 99) : 
+            _spi{s}, mySPISettings{SPI_CLOCKSPEED, MSBFIRST, SPI_MODE0}, SPI_Address{0x20}, resetPin{rp}, csPin{cs}, useHwAddress{false}, regPairs{}, deviceRegs{}, deferred{false} {}
+
+        /* addr is the hardware address set by A2..A0 (0...7 or 0x20...0x27). With it IOCON.HAEN 
+         * is enabled and up to 8 devices can share one CS line. Init() only writes to the other 
+         * devices of the line if this one has HAEN=0 (reset), see restoreHwAddressing(). */
+        MyMCP23S17(SPIClass *s, uint8_t cs, uint8_t rp, uint8_t addr) : 
+            _spi{s}, mySPISettings{SPI_CLOCKSPEED, MSBFIRST, SPI_MODE0}, SPI_Address{(uint8_t)(0x20 | (addr & 0x07))}, resetPin{rp}, csPin{cs}, useHwAddress{true}, regPairs{}, deviceRegs{}, deferred{false} {}
 
         /* Public functions */
         bool Init();
         void reset(); 
+        void enableHwAddressing();
 
         void setPinMode(uint8_t, mcp_port, uint8_t);
         void setPortMode(uint8_t, mcp_port);
@@ -123,6 +263,25 @@ class MyMCP23S17{
         }
 
         void setPortX(uint8_t, uint8_t, mcp_port); 
+
+        /* Pins of both ports as 16 bit mask (bit 0...7 = GPA0...7, bit 8...15 = GPB0...7). Only the 
+         * pins in mask change. The levels are one frame (BANK=1: one per port touched by mask), 
+         * setPinModes() writes GPPU (only if the pull-ups change), then IODIR. */
+        void writePins(uint16_t mask, uint16_t values, bool useTransaction = true);
+
+        void writePinsBatch(uint16_t mask, uint16_t values) {
+            writePins(mask, values, false);
+        }
+
+        void togglePins(uint16_t mask, bool useTransaction = true);
+
+        void togglePinsBatch(uint16_t mask) {
+            togglePins(mask, false);
+        }
+
+        void setPinModes(uint16_t mask, uint8_t pinState);
+        /* also sets the input polarity of the pins in mask, IODIR and IPOL in one frame */
+        void setPinModes(uint16_t mask, uint8_t pinState, uint16_t activeLow);
         void setInterruptPinPol(uint8_t); 
         void setIntOdr(uint8_t);  
         void setInterruptOnChangePin(uint8_t, mcp_port); 
@@ -133,6 +292,17 @@ class MyMCP23S17{
         void setPinPullUp(uint8_t, mcp_port, uint8_t); 
         void setPortPullUp(uint8_t, mcp_port);
         uint8_t getPortPullUp(mcp_port);
+
+        /* Input polarity (IPOL): the device inverts the inputs set here, so getPin(), getPorts(), 
+         * getIntCaps() and the DEFVAL comparison see the "active" level, e.g. an active-low 
+         * switch reads 1 while it is closed. setPinModes(mask, mode, activeLow) sets directions 
+         * and polarity together. */
+        void setPinPolarity(uint8_t pin, mcp_port port, bool inverted);
+        void setPortPolarity(uint8_t invertedPins, mcp_port port);
+        uint8_t getPortPolarity(mcp_port port);
+        /* 16 bit: pins in activeLow are inverted, all others not */
+        void setActiveLow(uint16_t activeLow);
+        uint16_t getActiveLow() const { return regPairs[MCP_IPOL]; }
         void setIntMirror(uint8_t);
         uint8_t getIntFlag(mcp_port);
 
@@ -148,13 +318,102 @@ class MyMCP23S17{
             return getPort(port, false);
         }
 
+        /* Port A and B in one SPI frame, port A is the low byte, port B the high byte */
+        uint16_t getPorts(bool useTransaction = true);
+
+        uint16_t getPortsBatch() {
+            return getPorts(false);
+        }
+
         uint8_t getIntCap(mcp_port);
-        void setSPIClockSpeed(unsigned long clock); 
+        uint16_t getIntCaps();
+        uint16_t getIntFlags();
+        /* false if an ESP-IDF device could not be added with the new clock, it keeps the old one */
+        bool setSPIClockSpeed(unsigned long clock); 
         void softReset();
 
+        /* All writable registers are mirrored in the object, so setters don't need to read 
+         * the device. resyncShadow() reloads the mirror from the device in one SPI frame, 
+         * e.g. if the device has been configured by someone else. The output levels are taken 
+         * from OLAT, INTF/INTCAP are not read, so pending interrupts are kept. */
+        void resyncShadow();
+
+        /* Instead of Init() after a restart of the MCU only: attaches to a configured device 
+         * without writing to it, outputs keep their levels. Returns false if IOCON does not 
+         * match (other BANK layout or hardware addressing, MISO stuck high) or the device is 
+         * in its power-on state (reset, never configured, MISO stuck low), then Init() is 
+         * needed. A configuration of inputs only without pull-ups, IPOL or interrupts can't be 
+         * told from the power-on state, but Init() doesn't change anything there. */
+        bool adoptDeviceState();
+
+        /* Register pairs as 16 bit values, port A = low byte. setRegPair() writes the mirror and 
+         * the device, getRegPair() returns the mirror, readRegPair() reads the device. With BANK=0 
+         * a pair is one frame, with BANK=1 one frame per port. */
+        void setRegPair(mcp_reg reg, uint16_t val, bool useTransaction = true);
+        uint16_t getRegPair(mcp_reg reg) const { return regPairs[mirrorOf(reg)]; }
+        uint16_t readRegPair(mcp_reg reg, bool useTransaction = true);
+        /* The pairs first...last, pairs[0] = first. BANK=0: one frame, BANK=1: one frame per port */
+        void readRegPairs(mcp_reg first, mcp_reg last, uint16_t *pairs, bool useTransaction = true);
+
+        /* Complete configuration: apply() writes all registers in one frame (outputs are enabled 
+         * after their latches and pull-ups are set) and, with verify, reads them back in one 
+         * frame. capture() reads the configuration from the device, getConfig() from the mirror. */
+        bool apply(const MCP23S17Config &cfg, bool verify = false);
+        MCP23S17Config capture();
+        MCP23S17Config getConfig();
+
+        /* Deferred mode: setters only change the register mirror, commit() writes the registers
+         * which differ from the device in as few frames as possible. setDeferred(false) commits. */
+        void setDeferred(bool on);
+        bool isDeferred() const { return deferred; }
+        bool hasPendingWrites();
+        void commit(bool useTransaction = true);
+
+        void commitBatch() {
+            commit(false);
+        }
+
+        /* Asynchronous transfers. With an ESP-IDF device attached (ESP32) frames are queued to the 
+         * SPI driver and sent by DMA, on other targets they are sent immediately. The callback 
+         * is called from pollAsync() / MCP23S17Job::wait(), not from an interrupt. prepareWrite() 
+         * is a raw frame, it doesn't update the mirror (setPortsAsync() does). */
+#ifndef MyMCP23S17_BANK1   // GPIOA and GPIOB in one frame
+        bool setPortsAsync(MCP23S17Job &job, uint8_t portLevelA, uint8_t portLevelB, mcp_job_callback cb = nullptr, void *arg = nullptr);
+        bool getPortsAsync(MCP23S17Job &job, mcp_job_callback cb = nullptr, void *arg = nullptr);
+#endif
+        void prepareWrite(MCP23S17Job &job, uint8_t reg, const uint8_t *vals, uint8_t count);
+        void prepareRead(MCP23S17Job &job, uint8_t reg, uint8_t count);
+        bool submitAsync(MCP23S17Job &job, mcp_job_callback cb = nullptr, void *arg = nullptr);
+        void pollAsync();
+        void finishAsync();
+
+        /* CS backend, selectable at runtime: by default frames go through the SPIClass and CS is 
+         * toggled by GPIO. On ESP32 the expander can instead be an ESP-IDF SPI device, then the 
+         * SPI peripheral generates CS (with csSetup / csHold cycles) and transfers use DMA. 
+         * Devices sharing one CS line (hardware addresses) have to use the GPIO backend. */
+#ifdef MyMCP23S17_HAS_IDF_SPI
+        static constexpr int IDF_QUEUE_SIZE = 4;
+        static bool beginIdfBus(spi_host_device_t host, int sck, int miso, int mosi);
+        bool beginIdfDevice(spi_host_device_t host, uint32_t clock = SPI_CLOCKSPEED, uint8_t csSetup = 0, uint8_t csHold = 0);
+        void attachIdfDevice(spi_device_handle_t handle);
+        void endIdfDevice();
+#endif
+        bool usesIdfDevice() const;
+
+        /* Burst access to count consecutive registers (max. NUM_REGISTERS) in one SPI frame. 
+         * writeRegs() also updates the mirror of the written registers. */
+        void writeRegs(uint8_t reg, const uint8_t *vals, uint8_t count, bool useTransaction = true);
+        void readRegs(uint8_t reg, uint8_t *vals, uint8_t count, bool useTransaction = true);
+
+        /* Keeps the bus (SPI transaction, with MyMCP23S17_THREAD_SAFE also the bus lock) until 
+         * endBatch(). Prefer MCP23S17Batch, which ends the batch at the end of its scope. */
         void startBatch();
         void endBatch();
 
+#ifdef MyMCP23S17_THREAD_SAFE
+        MCP23S17BusLock *getBusLock() { return busLock; }
+#endif
+
 #ifdef DEBUG_MyMCP23S17  // see MyMCP23S17_config.h
         void printAllRegisters();
         void printBin(uint8_t val);
@@ -162,6 +421,9 @@ class MyMCP23S17{
         
     protected:
 
+        MyMCP23S17(SPIClass *s, uint8_t cs, uint8_t rp, uint8_t addr, bool hwAddress) : 
+            _spi{s}, mySPISettings{SPI_CLOCKSPEED, MSBFIRST, SPI_MODE0}, SPI_Address{(uint8_t)(0x20 | (addr & 0x07))}, resetPin{rp}, csPin{cs}, useHwAddress{hwAddress}, regPairs{}, deviceRegs{}, deferred{false} {}
+
         void setIoCon(uint8_t, mcp_port);
         uint8_t getIoCon(mcp_port);
         void setGpIntEn(uint8_t, mcp_port);
@@ -170,7 +432,68 @@ class MyMCP23S17{
         uint8_t getIntCon(mcp_port);
         void setDefVal(uint8_t, mcp_port);
         uint8_t getDefVal(mcp_port);
+        void setShadowToResetValues();
+        void selectBank1();
+        void restoreHwAddressing();
+        void broadcastIoCon(uint8_t ioConAddr, uint8_t val);
+        bool beginBus();
+        /* OLAT and IODIR...GPPU of both ports, stored by slot: BANK=0 one frame from OLATA (wraps 
+         * around to IODIRA), BANK=1 one frame from OLATA and one from OLATB */
+        void readState(uint8_t *slots, bool useTransaction = true);
+        static constexpr uint8_t NUM_STATE_REGS = MCP_GPPU + 2;  // per port: OLAT, IODIR...GPPU
+
+        /* Register map: regPairs[] holds the mirror per mcp_reg (OLAT is mirrored by GPIO), 
+         * deviceRegs[] the device image per slot. A slot is the BANK=0 address (2 * reg + port), 
+         * so it does not depend on the layout. */
+        static constexpr mcp_reg mirrorOf(mcp_reg reg) { return reg == MCP_OLAT ? MCP_GPIO : reg; }
+        static uint16_t pinMask(uint8_t pin, mcp_port port) { return (uint16_t)(1 << pin) << (8 * port); }
+        static uint16_t portBits(uint8_t val, mcp_port port) { return (uint16_t)val << (8 * port); }
+        uint8_t portValue(mcp_reg reg, mcp_port port) const { return regPairs[mirrorOf(reg)] >> (8 * port); }
+        uint8_t slotOf(uint8_t addr) const;
+        uint8_t nextAddr(uint8_t addr) const;
+        uint8_t shadowValue(uint8_t addr);
+        uint8_t deviceValue(uint8_t addr) const { return deviceRegs[slotOf(addr)]; }
+        bool isWritable(uint8_t addr);
+        void noteDeviceReg(uint8_t addr, uint8_t val);
+        void noteMirrorReg(uint8_t addr, uint8_t val);
+
+        /* sets the bits of mask in a mirrored pair to bits */
+        void updatePair(mcp_reg reg, uint16_t mask, uint16_t bits) {
+            MCP_SHADOW_SET(regPairs[reg], bits & mask);
+            MCP_SHADOW_CLR(regPairs[reg], ~bits & mask);
+        }
+        void updatePinModes(uint16_t mask, uint8_t mode);
+        /* true if the mirror of a pair differs from the device image in a port of mask */
+        bool pairDiffers(mcp_reg reg, uint16_t mask) const {
+            return ((mask & 0x00FF) && portValue(reg, A) != deviceRegs[2 * reg])
+                || ((mask & 0xFF00) && portValue(reg, B) != deviceRegs[2 * reg + 1]);
+        }
+
+        /* Write the ports in mask of a mirrored pair (writePairs: of the pairs first...last) to the 
+         * device, skipped in deferred mode. The mirror is read under the bus lock, so with 
+         * MyMCP23S17_THREAD_SAFE the frame has the bits of all tasks. */
+        void writePair(mcp_reg reg, uint16_t mask = 0xFFFF, bool useTransaction = true) {
+            if(!deferred){
+                sendPair(reg, mask, useTransaction);
+            }
+        }
+        void writePairs(mcp_reg first, mcp_reg last, uint16_t mask = 0xFFFF, bool useTransaction = true);
+        void sendPair(mcp_reg reg, uint16_t mask, bool useTransaction);
+        /* count registers from the mirror, sequentially from addr, in one frame */
+        void writeImage(uint8_t addr, uint8_t count, bool useTransaction = true);
+        /* count registers sequentially from addr in one frame, stored by slot */
+        void readImage(uint8_t addr, uint8_t *slots, uint8_t count, bool useTransaction = true);
+        static uint16_t slotPair(const uint8_t *slots, mcp_reg reg) {
+            return (uint16_t)slots[2 * reg + 1] << 8 | slots[2 * reg];
+        }
         
+        uint8_t encodeFrame(uint8_t *buf, bool isRead, uint8_t reg, const uint8_t *vals, uint8_t count);
+        void sendRegs(uint8_t reg, const uint8_t *vals, uint8_t count, bool useTransaction = true);
+        void transferFrame(uint8_t *buf, uint8_t len, bool useTransaction = true);
+        void noteWrittenFrame(const uint8_t *buf, uint8_t len);
+        void noteReadFrame(uint8_t reg, const uint8_t *vals, uint8_t count);
+        void completeJob(MCP23S17Job &job);
+
         void write(uint8_t reg, uint8_t val, bool useTransaction = true);
         void write(uint8_t reg, uint8_t valA, uint8_t valB, bool useTransaction = true);
         uint8_t read(uint8_t reg, bool useTransaction = true);
@@ -184,7 +507,41 @@ class MyMCP23S17{
         const uint8_t SPI_Address;
         const uint8_t resetPin;
         const uint8_t csPin;
-        uint8_t ioDirA, ioDirB;
-        uint8_t gpioA, gpioB;
+        const bool useHwAddress;
+        uint16_t regPairs[MCP_NUM_REGS];    // mirror, IOCON in both bytes
+        uint8_t deviceRegs[NUM_REGISTERS];  // register values last written to / read from the device, by slot
+        bool deferred;
+#ifdef MyMCP23S17_THREAD_SAFE
+        MCP23S17BusLock *busLock = nullptr;
+#endif
+#ifdef MyMCP23S17_HAS_IDF_SPI
+        spi_device_handle_t idfDevice = nullptr;
+        spi_host_device_t idfHost = SPI2_HOST;
+        uint32_t idfClock = SPI_CLOCKSPEED;
+        uint8_t idfCsSetup = 0;
+        uint8_t idfCsHold = 0;
+        bool ownsIdfDevice = false;
+        uint8_t asyncPending = 0;
+#endif
 };
 
+/* Scoped batch: startBatch() in the constructor, endBatch() in the destructor */
+class MCP23S17Batch{
+
+    public:
+
+        explicit MCP23S17Batch(MyMCP23S17 &d) : dev{d} {
+            dev.startBatch();
+        }
+
+        ~MCP23S17Batch() {
+            dev.endBatch();
+        }
+
+        MCP23S17Batch(const MCP23S17Batch &) = delete;
+        MCP23S17Batch &operator=(const MCP23S17Batch &) = delete;
+
+    private:
+
+        MyMCP23S17 &dev;
+};
@@ -0,0 +1,138 @@
+/*****************************************
+Bus manager for several MCP23S17 on one SPI interface, see MyMCP23S17_Bus.h
+
+*******************************************/
+
+#include "MyMCP23S17_Bus.h"
+
+int8_t MCP23S17Bus::addDevice(MyMCP23S17 *dev){
+    if(numDevices >= MAX_DEVICES){
+        return -1;
+    }
+    devices[numDevices] = dev;
+    dev->mySPISettings = mySPISettings;  // the shared transactions use the settings of device 0
+    return numDevices++;
+}
+
+bool MCP23S17Bus::Init(){
+    MCP_INSTRUMENT_NAMED("Bus::Init");
+    bool ok = true;
+    for(uint8_t i=0; i<numDevices; i++){
+        devices[i]->mySPISettings = mySPISettings;  // Init() already runs with the bus clock
+        if(!devices[i]->Init()){
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool MCP23S17Bus::setSPIClockSpeed(unsigned long clock){
+    mySPISettings = SPISettings(clock, MSBFIRST, SPI_MODE0);
+    bool ok = true;
+    for(uint8_t i=0; i<numDevices; i++){
+        if(!devices[i]->setSPIClockSpeed(clock)){
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void MCP23S17Bus::setPin(uint8_t idx, uint8_t pin, mcp_port port, uint8_t pinLevel){
+    if(idx >= numDevices){
+        return;
+    }
+    MyMCP23S17 *dev = devices[idx];
+    if(pinLevel==HIGH){
+        MCP_SHADOW_SET(dev->regPairs[MCP_GPIO], MyMCP23S17::pinMask(pin, port));
+    }
+    else if(pinLevel==LOW){
+        MCP_SHADOW_CLR(dev->regPairs[MCP_GPIO], MyMCP23S17::pinMask(pin, port));
+    }
+}
+
+void MCP23S17Bus::togglePin(uint8_t idx, uint8_t pin, mcp_port port){
+    if(idx >= numDevices){
+        return;
+    }
+    MCP_SHADOW_TGL(devices[idx]->regPairs[MCP_GPIO], MyMCP23S17::pinMask(pin, port));
+}
+
+void MCP23S17Bus::setPort(uint8_t idx, uint8_t portLevel, mcp_port port){
+    if(idx >= numDevices){
+        return;
+    }
+    devices[idx]->updatePair(MCP_GPIO, MyMCP23S17::portBits(0xFF, port), MyMCP23S17::portBits(portLevel, port));
+}
+
+void MCP23S17Bus::setPorts(uint8_t idx, uint8_t portLevelA, uint8_t portLevelB){
+    if(idx >= numDevices){
+        return;
+    }
+    devices[idx]->regPairs[MCP_GPIO] = (uint16_t)portLevelB << 8 | portLevelA;
+}
+
+void MCP23S17Bus::flush(){
+    MCP_INSTRUMENT_NAMED("Bus::flush");
+    bool pending = false;
+    for(uint8_t i=0; i<numDevices && !pending; i++){
+        pending = devices[i]->hasPendingWrites();
+    }
+    if(!pending){
+        return;
+    }
+
+    MCP_BUS_GUARD(MCP23S17BusLock::forBus(_spi));
+    bool shared = sharedTransaction();
+    if(shared){
+        devices[0]->startBatch();
+    }
+    for(uint8_t i=0; i<numDevices; i++){
+        if(!shared){
+            devices[i]->startBatch();
+        }
+        devices[i]->commitBatch();
+        if(!shared){
+            devices[i]->endBatch();
+        }
+    }
+    if(shared){
+        devices[0]->endBatch();
+    }
+}
+
+void MCP23S17Bus::scanAll(uint16_t *ports){
+    MCP_INSTRUMENT_NAMED("Bus::scanAll");
+    if(numDevices == 0){
+        return;
+    }
+    MCP_BUS_GUARD(MCP23S17BusLock::forBus(_spi));
+    bool shared = sharedTransaction();
+    if(shared){
+        devices[0]->startBatch();
+    }
+    for(uint8_t i=0; i<numDevices; i++){
+        if(!shared){
+            devices[i]->startBatch();
+        }
+        ports[i] = devices[i]->getPortsBatch();
+        if(!shared){
+            devices[i]->endBatch();
+        }
+    }
+    if(shared){
+        devices[0]->endBatch();
+    }
+}
+
+/* Arduino SPI: one transaction for all devices (they share the bus settings). ESP-IDF: only 
+ * the device which acquired the bus may transfer, so every device gets its own batch. */
+bool MCP23S17Bus::sharedTransaction(){
+#ifdef MyMCP23S17_HAS_IDF_SPI
+    for(uint8_t i=0; i<numDevices; i++){
+        if(devices[i]->idfDevice){
+            return false;
+        }
+    }
+#endif
+    return true;
+}
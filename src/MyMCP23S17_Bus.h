@@ -0,0 +1,56 @@
+/*****************************************
+Bus manager for several MCP23S17 on one SPI interface.
+
+MCP23S17Bus owns the SPI settings of the bus. Port writes are staged in the
+devices and written by flush() for all devices within one SPI transaction.
+flush() commits everything that is pending in the devices (see
+MyMCP23S17::setDeferred()), so the devices may also be used in deferred
+mode directly. scanAll() reads port A and B of all devices in one
+transaction. With the ESP-IDF backend (MyMCP23S17::beginIdfDevice()) each device
+gets its own transaction, since only the device which acquired the bus
+may transfer.
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+class MCP23S17Bus{
+
+    public:
+
+        static constexpr uint8_t MAX_DEVICES = 16;
+
+        MCP23S17Bus(SPIClass *s, uint32_t clock = MyMCP23S17::SPI_CLOCKSPEED) :
+            _spi{s}, mySPISettings{clock, MSBFIRST, SPI_MODE0}, devices{}, numDevices{0} {}
+
+        /* returns the index of the device on the bus or -1 if the bus is full */
+        int8_t addDevice(MyMCP23S17 *dev);
+        uint8_t getNumDevices() const { return numDevices; }
+        MyMCP23S17 *getDevice(uint8_t idx) { return (idx < numDevices) ? devices[idx] : nullptr; }
+
+        /* Init() of all devices, the bus clock is applied to all of them */
+        bool Init();
+        /* false if a device could not take the clock, see MyMCP23S17::setSPIClockSpeed() */
+        bool setSPIClockSpeed(unsigned long clock);
+
+        /* staged port writes, written by flush() */
+        void setPin(uint8_t idx, uint8_t pin, mcp_port port, uint8_t pinLevel);
+        void togglePin(uint8_t idx, uint8_t pin, mcp_port port);
+        void setPort(uint8_t idx, uint8_t portLevel, mcp_port port);
+        void setPorts(uint8_t idx, uint8_t portLevelA, uint8_t portLevelB);
+        void flush();
+
+        /* ports[i] = port A (low byte) and port B (high byte) of device i */
+        void scanAll(uint16_t *ports);
+
+    protected:
+
+        bool sharedTransaction();
+
+        SPIClass *_spi;
+        SPISettings mySPISettings;
+        MyMCP23S17 *devices[MAX_DEVICES];
+        uint8_t numDevices;
+};
@@ -0,0 +1,76 @@
+/*****************************************
+Debouncer for the 16 inputs of an MCP23S17, see MyMCP23S17_Debounce.h
+
+*******************************************/
+
+#include "MyMCP23S17_Debounce.h"
+
+void MCP23S17Debouncer::begin(uint16_t initialState){
+    state = lastSample = initialState;
+    risen = fallen = 0;
+    restart(0xFFFF);
+}
+
+void MCP23S17Debouncer::setSamples(uint16_t pinMask, uint8_t samples){
+    if(samples < 1){
+        samples = 1;
+    }
+    if(samples > MAX_SAMPLES){
+        samples = MAX_SAMPLES;
+    }
+    for(uint8_t k=0; k<4; k++){
+        if(samples & (1 << k)){
+            reload[k] |= pinMask;
+        }
+        else{
+            reload[k] &= ~pinMask;
+        }
+    }
+    restart(pinMask);
+}
+
+void MCP23S17Debouncer::setDebounceTime(uint16_t pinMask, uint32_t debounceUs, uint32_t samplePeriodUs){
+    if(samplePeriodUs == 0){
+        return;
+    }
+    uint32_t samples = (debounceUs + samplePeriodUs - 1) / samplePeriodUs;
+    setSamples(pinMask, samples > MAX_SAMPLES ? MAX_SAMPLES : samples);
+}
+
+/* Pins which differ from the state count down, all others are reloaded. A pin whose
+ * counter reaches zero toggles its state and is reloaded as well. */
+uint16_t MCP23S17Debouncer::update(uint16_t sample){
+    lastSample = sample;
+    uint16_t delta = sample ^ state;
+
+    uint16_t borrow = delta;
+    for(uint8_t k=0; k<4; k++){
+        uint16_t c = count[k];
+        count[k] = c ^ borrow;
+        borrow &= ~c;
+    }
+    uint16_t toggle = delta & ~(count[0] | count[1] | count[2] | count[3]);
+
+    restart(~delta | toggle);
+    state ^= toggle;
+    risen = toggle & state;
+    fallen = toggle & ~state;
+    return toggle;
+}
+
+uint16_t MCP23S17Debouncer::updateCaptured(uint16_t intFlags, uint16_t intCaps){
+    return update((lastSample & ~intFlags) | (intCaps & intFlags));
+}
+
+uint16_t MCP23S17Debouncer::poll(bool useTransaction){
+    if(!_dev){
+        return 0;
+    }
+    return update(_dev->getPorts(useTransaction));
+}
+
+void MCP23S17Debouncer::restart(uint16_t pinMask){
+    for(uint8_t k=0; k<4; k++){
+        count[k] = (count[k] & ~pinMask) | (reload[k] & pinMask);
+    }
+}
@@ -0,0 +1,70 @@
+/*****************************************
+Debouncer for the 16 inputs of an MCP23S17.
+
+MCP23S17Debouncer takes periodic 16 bit samples (port A = low byte,
+port B = high byte, as returned by getPorts()) and outputs the
+debounced state plus the pins which rose / fell with the last sample.
+
+The filter is a vertical counter: bit k of the 16 pin counters is kept
+in one 16 bit word (bit plane), so all pins are processed with a few
+bitwise operations per sample, independent of the number of pins which
+bounce. A pin changes its state after it differed from the state in
+n consecutive samples; every differing sample restarts the count.
+n = 1...15 is set per pin (1 = no filtering).
+
+Samples can come from polling (poll() / update()) or from the interrupt
+path: updateCaptured() takes INTF / INTCAP and replaces the flagged
+pins of the last sample. Keep sampling while isSettling() is true, a
+single interrupt does not produce the n samples needed.
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+class MCP23S17Debouncer{
+
+    public:
+
+        static constexpr uint8_t MAX_SAMPLES = 15;
+        static constexpr uint8_t DEFAULT_SAMPLES = 4;
+
+        MCP23S17Debouncer(MyMCP23S17 *dev = nullptr) : _dev{dev}, state{0}, lastSample{0},
+            risen{0}, fallen{0}, count{}, reload{} {
+            setSamples(0xFFFF, DEFAULT_SAMPLES);
+        }
+
+        /* sets the state without filtering, e.g. to the first sample */
+        void begin(uint16_t initialState);
+        /* number of consecutive samples (1...15) needed to accept a change of the pins in pinMask */
+        void setSamples(uint16_t pinMask, uint8_t samples);
+        /* the same as a time, rounded up to full sample periods */
+        void setDebounceTime(uint16_t pinMask, uint32_t debounceUs, uint32_t samplePeriodUs);
+
+        /* filters one sample, returns the pins which changed state */
+        uint16_t update(uint16_t sample);
+        /* interrupt path: the captured levels of the flagged pins replace the last sample */
+        uint16_t updateCaptured(uint16_t intFlags, uint16_t intCaps);
+        /* reads port A and B of the device in one frame and filters them */
+        uint16_t poll(bool useTransaction = true);
+
+        uint16_t getState() const { return state; }
+        bool getPin(uint8_t pin) const { return (state >> pin) & 1; }
+        uint16_t getRising() const { return risen; }
+        uint16_t getFalling() const { return fallen; }
+        /* pins whose last sample differs from the debounced state */
+        bool isSettling() const { return lastSample != state; }
+
+    protected:
+
+        void restart(uint16_t pinMask);
+
+        MyMCP23S17 *_dev;
+        uint16_t state;
+        uint16_t lastSample;
+        uint16_t risen;
+        uint16_t fallen;
+        uint16_t count[4];   // bit planes of the remaining samples
+        uint16_t reload[4];  // bit planes of the configured samples
+};
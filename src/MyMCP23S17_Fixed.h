@@ -0,0 +1,161 @@
+/*****************************************
+Compile-time specialized front-end for an MCP23S17 with fixed wiring.
+
+MCP23S17<CsPin, HwAddr, ResetPin> is a MyMCP23S17, so the complete runtime
+API keeps working. In addition, pins and ports which are known at build
+time can be addressed by template arguments:
+
+    MCP23S17<5> myMCP(&SPI);          // CS = GPIO 5, no hardware address
+    MCP23S17<5, 3> other(&SPI);       // CS = GPIO 5, A2/A1/A0 = 0/1/1 (HAEN)
+
+    myMCP.setPin<A, 3>(HIGH);
+    auto led = myMCP.pin<A, 3>();     // handle, e.g. to pass around
+    led.toggle();
+    auto in = myMCP.port<B>();
+    uint8_t val = in.get();
+
+Opcode and register numbers are constants, so a fixed-pin setPin() is a
+shadow bit update plus one 3 byte frame without any port branches. The
+frame is sent by transferFrame() like all others (CS, transaction,
+ESP-IDF backend).
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+template <uint8_t CsPin, int8_t HwAddr = -1, uint8_t ResetPin = 99>
+class MCP23S17 : public MyMCP23S17 {
+
+    public:
+
+        static_assert(HwAddr < 8, "hardware address has to be 0...7 (or -1 for none)");
+#ifdef MyMCP23S17_USE_ESP32_REG_WRITE
+        static_assert(CsPin < 64 && GPIO_IS_VALID_OUTPUT_GPIO(CsPin), "CS pin has to be an output GPIO");
+#endif
+
+        static constexpr bool HW_ADDRESSING = HwAddr >= 0;
+        static constexpr uint8_t OPCODE_W = OPCODE_WRITE | (HW_ADDRESSING ? (HwAddr << 1) : 0);
+        static constexpr uint8_t OPCODE_R = OPCODE_W | SPI_READ;
+
+        template <mcp_port P>
+        struct PortRegs {
+            static constexpr uint8_t IODIR = (P == A) ? IODIRA : IODIRB;
+            static constexpr uint8_t GPIO  = (P == A) ? GPIOA : GPIOB;
+            static constexpr uint8_t OLAT  = (P == A) ? OLATA : OLATB;
+            static constexpr uint8_t GPPU  = (P == A) ? GPPUA : GPPUB;
+        };
+
+        /* handle of a fixed pin */
+        template <mcp_port P, uint8_t N>
+        class Pin {
+            public:
+                static_assert(N < 8, "pin has to be 0...7");
+                static constexpr uint8_t MASK = 1 << N;
+
+                explicit Pin(MCP23S17 &d) : dev{d} {}
+                void set(uint8_t level, bool useTransaction = true) { dev.template setPin<P, N>(level, useTransaction); }
+                void toggle(bool useTransaction = true) { dev.template togglePin<P, N>(useTransaction); }
+                bool get(bool useTransaction = true) { return dev.template getPin<P, N>(useTransaction); }
+                void setMode(uint8_t mode) { dev.setPinMode(N, P, mode); }
+
+            private:
+                MCP23S17 &dev;
+        };
+
+        /* handle of a fixed port */
+        template <mcp_port P>
+        class Port {
+            public:
+                explicit Port(MCP23S17 &d) : dev{d} {}
+                void set(uint8_t level, bool useTransaction = true) { dev.template setPort<P>(level, useTransaction); }
+                uint8_t get(bool useTransaction = true) { return dev.template getPort<P>(useTransaction); }
+                void setMode(uint8_t val, uint8_t pu = INPUT) {
+                    if(pu == INPUT_PULLUP){
+                        dev.setPortMode(val, P, pu);
+                    }
+                    else{
+                        dev.setPortMode(val, P);
+                    }
+                }
+
+            private:
+                MCP23S17 &dev;
+        };
+
+        /* constructor */
+        MCP23S17(SPIClass *s) : MyMCP23S17(s, CsPin, ResetPin, HW_ADDRESSING ? HwAddr : 0, HW_ADDRESSING) {}
+
+        /* the runtime API is still available */
+        using MyMCP23S17::setPin;
+        using MyMCP23S17::togglePin;
+        using MyMCP23S17::setPort;
+        using MyMCP23S17::getPin;
+        using MyMCP23S17::getPort;
+
+        template <mcp_port P, uint8_t N>
+        Pin<P, N> pin() { return Pin<P, N>(*this); }
+
+        template <mcp_port P>
+        Port<P> port() { return Port<P>(*this); }
+
+        template <mcp_port P, uint8_t N>
+        void setPin(uint8_t pinLevel, bool useTransaction = true) {
+            static_assert(N < 8, "pin has to be 0...7");
+            if(pinLevel == HIGH){
+                MCP_SHADOW_SET(regPairs[MCP_GPIO], pinMask(N, P));
+            }
+            else if(pinLevel == LOW){
+                MCP_SHADOW_CLR(regPairs[MCP_GPIO], pinMask(N, P));
+            }
+            writeGpio<P>(useTransaction);
+        }
+
+        template <mcp_port P, uint8_t N>
+        void togglePin(bool useTransaction = true) {
+            static_assert(N < 8, "pin has to be 0...7");
+            MCP_SHADOW_TGL(regPairs[MCP_GPIO], pinMask(N, P));
+            writeGpio<P>(useTransaction);
+        }
+
+        template <mcp_port P>
+        void setPort(uint8_t portLevel, bool useTransaction = true) {
+            updatePair(MCP_GPIO, portBits(0xFF, P), portBits(portLevel, P));
+            writeGpio<P>(useTransaction);
+        }
+
+        template <mcp_port P, uint8_t N>
+        bool getPin(bool useTransaction = true) {
+            static_assert(N < 8, "pin has to be 0...7");
+            return (getPort<P>(useTransaction) >> N) & 1;
+        }
+
+        template <mcp_port P>
+        uint8_t getPort(bool useTransaction = true) {
+            uint8_t frame[3] = {OPCODE_R, PortRegs<P>::GPIO, 0x00};
+            transferFixed(frame, useTransaction);
+            return frame[2];
+        }
+
+    protected:
+
+        /* the mirror is read under the bus lock, the frame has the latest bits of all tasks */
+        template <mcp_port P>
+        void writeGpio(bool useTransaction) {
+            if(deferred){
+                return;
+            }
+            MCP_BUS_GUARD(busLock);
+            uint8_t val = portValue(MCP_GPIO, P);
+            uint8_t frame[3] = {OPCODE_W, PortRegs<P>::GPIO, val};
+            noteDeviceReg(PortRegs<P>::GPIO, val);
+            transferFixed(frame, useTransaction);
+        }
+
+        /* the same path as the runtime API, only the arguments are constants */
+        void transferFixed(uint8_t *frame, bool useTransaction) {
+            MCP_INSTRUMENT_NAMED("Fixed::transfer");
+            transferFrame(frame, 3, useTransaction);
+        }
+};
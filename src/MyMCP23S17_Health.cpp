@@ -0,0 +1,140 @@
+/*****************************************
+Health monitor for MCP23S17 devices, see MyMCP23S17_Health.h
+
+*******************************************/
+
+#include "MyMCP23S17_Health.h"
+
+int8_t MCP23S17Health::addDevice(MyMCP23S17 *dev){
+    if(numDevices >= MAX_DEVICES){
+        return -1;
+    }
+    devices[numDevices] = dev;
+    return numDevices++;
+}
+
+bool MCP23S17Health::poll(){
+    if(numDevices == 0 || millis() - lastCheck < intervalMs){
+        return true;
+    }
+    lastCheck = millis();
+    bool ok = check(nextDevice);
+    nextDevice = (nextDevice + 1) % numDevices;
+    return ok;
+}
+
+/* Runs of registers read in one frame each: the address pointer wraps around from OLAT to 
+ * IODIR, so INTF/INTCAP are skipped. BANK=1: OLATA is followed by IODIRB...GPPUB and OLATB 
+ * by IODIRA...GPPUA. */
+#ifdef MyMCP23S17_BANK1
+static constexpr uint8_t runs[][2] = {{MyMCP23S17::OLATA, 8}, {MyMCP23S17::OLATB, 8}};
+#else
+static constexpr uint8_t runs[][2] = {{MyMCP23S17::OLATA, 16}};
+#endif
+static constexpr uint8_t NUM_RUNS = sizeof(runs) / sizeof(runs[0]);
+
+bool MCP23S17Health::check(uint8_t idx){
+    MCP_INSTRUMENT_NAMED("Health::check");
+    if(idx >= numDevices){
+        return false;
+    }
+    MyMCP23S17 *dev = devices[idx];
+    MCP_BUS_GUARD(dev->busLock);
+    uint8_t regs[NUM_CHECKED];
+    uint8_t expected[NUM_CHECKED];
+    uint8_t actual[NUM_CHECKED];
+    uint8_t n = 0;
+    for(uint8_t r=0; r<NUM_RUNS; r++){
+        uint8_t reg = runs[r][0];
+        for(uint8_t i=0; i<runs[r][1]; i++, n++){
+            regs[n] = reg;
+            expected[n] = dev->deviceValue(reg);
+            reg = dev->nextAddr(reg);
+        }
+    }
+
+    readRuns(dev, actual);
+    stats.checks++;
+
+    uint8_t firstBad = 0;
+    if(matches(expected, actual, firstBad)){
+        return true;
+    }
+
+    stats.mismatches++;
+    stats.lastErrorMs = millis();
+    stats.lastErrorDevice = idx;
+    stats.lastErrorReg = regs[firstBad];
+    bool allLow = true;
+    bool allHigh = true;
+    for(uint8_t i=0; i<NUM_CHECKED; i++){
+        allLow = allLow && actual[i] == 0x00;
+        allHigh = allHigh && actual[i] == 0xFF;
+    }
+    if(allLow){
+        stats.stuckLow++;
+    }
+    if(allHigh){
+        stats.stuckHigh++;
+    }
+
+    bool recovered = autoRecover && recover(dev, expected);
+    /* the read-back replaced the image of the device, the expected values stay the target */
+    for(uint8_t i=0; i<NUM_CHECKED; i++){
+        dev->noteDeviceReg(regs[i], expected[i]);
+    }
+    return recovered;
+}
+
+/* Writes OLAT first, then IODIR...GPPU (wrapping around), and reads it back. After a power-on 
+ * reset HAEN is 0 and the device only answers address 0, so with a hardware address HAEN is 
+ * restored first. BANK=1: the layout is selected again first (IOCON at the BANK=0 address, 
+ * HAEN included) and checked. */
+bool MCP23S17Health::recover(MyMCP23S17 *dev, const uint8_t *expected){
+    uint8_t actual[NUM_CHECKED];
+    uint8_t firstBad = 0;
+
+#ifdef MyMCP23S17_BANK1
+    /* a device which was reset is in BANK=0 and would take the runs as other registers */
+    dev->selectBank1();
+    if(dev->read(MyMCP23S17::IOCONA) != dev->getIoCon(A)){
+        stats.failedRecoveries++;
+        return false;
+    }
+#else
+    dev->restoreHwAddressing();
+#endif
+    writeRuns(dev, expected);
+    readRuns(dev, actual);
+    if(!matches(expected, actual, firstBad)){
+        stats.failedRecoveries++;
+        return false;
+    }
+    stats.recoveries++;
+    stats.lastRecoveryMs = millis();
+    return true;
+}
+
+void MCP23S17Health::readRuns(MyMCP23S17 *dev, uint8_t *vals){
+    for(uint8_t r=0; r<NUM_RUNS; r++){
+        dev->readRegs(runs[r][0], vals, runs[r][1]);
+        vals += runs[r][1];
+    }
+}
+
+void MCP23S17Health::writeRuns(MyMCP23S17 *dev, const uint8_t *vals){
+    for(uint8_t r=0; r<NUM_RUNS; r++){
+        dev->sendRegs(runs[r][0], vals, runs[r][1]);
+        vals += runs[r][1];
+    }
+}
+
+bool MCP23S17Health::matches(const uint8_t *expected, const uint8_t *actual, uint8_t &firstBad){
+    for(uint8_t i=0; i<NUM_CHECKED; i++){
+        if(expected[i] != actual[i]){
+            firstBad = i;
+            return false;
+        }
+    }
+    return true;
+}
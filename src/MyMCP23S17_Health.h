@@ -0,0 +1,79 @@
+/*****************************************
+Health monitor for MCP23S17 devices.
+
+MCP23S17Health periodically reads back the registers of its devices and
+compares them with what the library wrote to them. This detects devices
+which were reset (ESD, brown-out, loose cable) or a stuck bus (all bytes
+0x00 or 0xFF). With autoRecover, the expected register image is written
+again and verified.
+
+Cost: one device is checked per interval (round robin), a check is one
+18 byte frame: OLATA, OLATB and IODIRA...GPPUB. The address pointer
+wraps around from OLATB to IODIRA, so INTF/INTCAP are not read and
+pending interrupts are not cleared. With IOCON.BANK=1 the same registers
+take two 10 byte frames (OLATA, IODIRB...GPPUB and OLATB, IODIRA...GPPUA).
+A recovery adds the same number of write and read frames, with BANK=1
+plus three frames which select the layout again and read back IOCON
+(after a reset the device is in BANK=0).
+
+Registers in the device are compared with the values last written (or
+read), not with the register mirror, so pending writes in deferred mode
+are not taken for errors.
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+struct MCP23S17HealthStats {
+    uint32_t checks;
+    uint32_t mismatches;        // checks with unexpected register values
+    uint32_t stuckLow;          // all bytes read were 0x00
+    uint32_t stuckHigh;         // all bytes read were 0xFF
+    uint32_t recoveries;        // successful re-applies
+    uint32_t failedRecoveries;
+    uint32_t lastErrorMs;       // millis() of the last mismatch
+    uint32_t lastRecoveryMs;
+    uint8_t lastErrorDevice;
+    uint8_t lastErrorReg;       // first register which did not match
+};
+
+class MCP23S17Health{
+
+    public:
+
+        static constexpr uint8_t MAX_DEVICES = 16;
+        static constexpr uint8_t NUM_CHECKED = 16;  // OLATA, OLATB, IODIRA...GPPUB
+
+        MCP23S17Health(uint32_t intervalMs = 1000, bool autoRecover = true) : devices{}, numDevices{0},
+            nextDevice{0}, intervalMs{intervalMs}, lastCheck{0}, autoRecover{autoRecover}, stats{} {}
+
+        /* returns the index of the device or -1 if there is no space left */
+        int8_t addDevice(MyMCP23S17 *dev);
+        void setInterval(uint32_t ms) { intervalMs = ms; }
+        void setAutoRecover(bool on) { autoRecover = on; }
+
+        /* checks the next device if the interval has passed, returns false on an error */
+        bool poll();
+        /* checks a device now, returns true if the registers are as expected (or were recovered) */
+        bool check(uint8_t idx);
+
+        const MCP23S17HealthStats &getStats() const { return stats; }
+        void resetStats() { stats = MCP23S17HealthStats{}; }
+
+    protected:
+
+        bool recover(MyMCP23S17 *dev, const uint8_t *expected);
+        void readRuns(MyMCP23S17 *dev, uint8_t *vals);
+        void writeRuns(MyMCP23S17 *dev, const uint8_t *vals);
+        static bool matches(const uint8_t *expected, const uint8_t *actual, uint8_t &firstBad);
+
+        MyMCP23S17 *devices[MAX_DEVICES];
+        uint8_t numDevices;
+        uint8_t nextDevice;
+        uint32_t intervalMs;
+        uint32_t lastCheck;
+        bool autoRecover;
+        MCP23S17HealthStats stats;
+};
@@ -0,0 +1,73 @@
+/*****************************************
+Change detection for the 16 inputs of an MCP23S17, see MyMCP23S17_InputTracker.h
+
+*******************************************/
+
+#include "MyMCP23S17_InputTracker.h"
+
+void MCP23S17InputTracker::begin(uint16_t initialState){
+    state = initialState;
+    changes = MCP23S17Changes{};
+}
+
+void MCP23S17InputTracker::begin(){
+    if(_dev){
+        begin(_dev->getPorts());
+    }
+}
+
+bool MCP23S17InputTracker::subscribe(uint16_t pinMask, mcp_change_callback cb, void *arg, mcp_edge edges){
+    if(numSubscriptions >= MAX_SUBSCRIPTIONS || !cb){
+        return false;
+    }
+    subscriptions[numSubscriptions++] = {pinMask, edges, cb, arg};
+    return true;
+}
+
+MCP23S17Changes MCP23S17InputTracker::update(uint16_t sample){
+    uint16_t delta = sample ^ state;
+    state = sample;
+    changes.rising = delta & sample;
+    changes.falling = delta & ~sample;
+    if(delta){
+        dispatch();
+    }
+    return changes;
+}
+
+MCP23S17Changes MCP23S17InputTracker::updateCaptured(uint16_t intFlags, uint16_t intCaps){
+    return update((state & ~intFlags) | (intCaps & intFlags));
+}
+
+MCP23S17Changes MCP23S17InputTracker::poll(bool useTransaction){
+    if(!_dev){
+        return MCP23S17Changes{};
+    }
+    return update(_dev->getPorts(useTransaction));
+}
+
+MCP23S17Changes MCP23S17InputTracker::pollInterrupts(bool useTransaction){
+    if(!_dev){
+        return MCP23S17Changes{};
+    }
+    uint16_t pairs[2] = {};
+    _dev->readRegPairs(MCP_INTF, MCP_INTCAP, pairs, useTransaction);
+    return updateCaptured(pairs[0], pairs[1]);
+}
+
+/* only the changed pins of a subscription are visited */
+void MCP23S17InputTracker::dispatch(){
+    for(uint8_t s=0; s<numSubscriptions; s++){
+        const Subscription &sub = subscriptions[s];
+        uint16_t hits = 0;
+        if(sub.edges & MCP_RISING){
+            hits |= changes.rising;
+        }
+        if(sub.edges & MCP_FALLING){
+            hits |= changes.falling;
+        }
+        for(uint8_t pin : MCP23S17Pins(hits & sub.pinMask)){
+            sub.callback(pin, (state >> pin) & 1, sub.arg);
+        }
+    }
+}
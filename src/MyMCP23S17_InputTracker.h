@@ -0,0 +1,106 @@
+/*****************************************
+Change detection for the 16 inputs of an MCP23S17.
+
+MCP23S17InputTracker keeps the last state of the inputs (port A = low
+byte, port B = high byte) and returns only what changed with a new
+sample: {rising, falling} masks. Samples are 16 bit reads (poll(), one
+frame via getPorts()) or the interrupt registers (pollInterrupts(), one
+frame INTF/INTCAP, the captured levels of the flagged pins are taken).
+
+Callbacks are registered for pins and edges. They are only called for
+pins which changed; without a change a sample costs one XOR. Set bits
+are visited with a bit scan (count trailing zeros), not a loop over all
+16 pins, also when iterating a mask in user code:
+
+  for(uint8_t pin : MCP23S17Pins(changes.rising)) { ... }
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+typedef enum MCP_EDGE {MCP_RISING = 1, MCP_FALLING = 2, MCP_BOTH_EDGES = 3} mcp_edge;
+
+struct MCP23S17Changes {
+    uint16_t rising;
+    uint16_t falling;
+
+    uint16_t changed() const { return rising | falling; }
+    explicit operator bool() const { return rising | falling; }
+};
+
+/* set bits of a mask as pins 0...15, lowest first */
+class MCP23S17Pins {
+
+    public:
+
+        class iterator {
+            public:
+                explicit iterator(uint16_t m) : mask{m} {}
+                uint8_t operator*() const { return __builtin_ctz(mask); }
+                iterator &operator++() { mask &= mask - 1; return *this; }  // clear lowest set bit
+                bool operator!=(const iterator &other) const { return mask != other.mask; }
+            private:
+                uint16_t mask;
+        };
+
+        explicit MCP23S17Pins(uint16_t m) : mask{m} {}
+        iterator begin() const { return iterator(mask); }
+        iterator end() const { return iterator(0); }
+
+    private:
+        uint16_t mask;
+};
+
+typedef void (*mcp_change_callback)(uint8_t pin, bool level, void *arg);
+
+class MCP23S17InputTracker{
+
+    public:
+
+        static constexpr uint8_t MAX_SUBSCRIPTIONS = 8;
+
+        MCP23S17InputTracker(MyMCP23S17 *dev = nullptr) : _dev{dev}, state{0}, changes{},
+            subscriptions{}, numSubscriptions{0} {}
+
+        /* sets the state without reporting changes */
+        void begin(uint16_t initialState);
+        /* reads the initial state from the device */
+        void begin();
+
+        /* callback for the edges of the pins in pinMask (bit 0...15), false if there is no space left */
+        bool subscribe(uint16_t pinMask, mcp_change_callback cb, void *arg = nullptr, mcp_edge edges = MCP_BOTH_EDGES);
+        void unsubscribeAll() { numSubscriptions = 0; }
+
+        /* takes a sample of all pins, returns the changes and calls the subscribed callbacks */
+        MCP23S17Changes update(uint16_t sample);
+        /* interrupt path: the captured levels of the flagged pins replace their state */
+        MCP23S17Changes updateCaptured(uint16_t intFlags, uint16_t intCaps);
+        /* reads port A and B of the device in one frame */
+        MCP23S17Changes poll(bool useTransaction = true);
+        /* reads INTF and INTCAP in one frame (clears the interrupt) */
+        MCP23S17Changes pollInterrupts(bool useTransaction = true);
+
+        uint16_t getState() const { return state; }
+        bool getPin(uint8_t pin) const { return (state >> pin) & 1; }
+        /* changes of the last sample */
+        MCP23S17Changes getChanges() const { return changes; }
+
+    protected:
+
+        struct Subscription {
+            uint16_t pinMask;
+            mcp_edge edges;
+            mcp_change_callback callback;
+            void *arg;
+        };
+
+        void dispatch();
+
+        MyMCP23S17 *_dev;
+        uint16_t state;
+        MCP23S17Changes changes;
+        Subscription subscriptions[MAX_SUBSCRIPTIONS];
+        uint8_t numSubscriptions;
+};
@@ -0,0 +1,127 @@
+/*****************************************
+Instrumentation for MyMCP23S17_INSTRUMENT, see MyMCP23S17_Instrument.h
+
+*******************************************/
+
+#include "MyMCP23S17_Instrument.h"
+#if defined(MyMCP23S17_THREAD_SAFE) && defined(MYMCP23S17_HOST)
+#include <mutex>
+#endif
+
+#ifdef MyMCP23S17_INSTRUMENT
+
+#if defined(MyMCP23S17_THREAD_SAFE) && defined(ARDUINO_ARCH_ESP32)
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+#define MCP_STATS_LOCK() portENTER_CRITICAL(&statsMux)
+#define MCP_STATS_UNLOCK() portEXIT_CRITICAL(&statsMux)
+#elif defined(MyMCP23S17_THREAD_SAFE) && defined(MYMCP23S17_HOST)
+static std::mutex statsMutex;
+#define MCP_STATS_LOCK() statsMutex.lock()
+#define MCP_STATS_UNLOCK() statsMutex.unlock()
+#else
+#define MCP_STATS_LOCK()
+#define MCP_STATS_UNLOCK()
+#endif
+
+MCP23S17ApiStats MCP23S17Instrument::apis[MAX_APIS] = {{"(other)", 0, 0, 0, 0, 0}};
+uint8_t MCP23S17Instrument::numApis = 1;
+#ifdef MyMCP23S17_THREAD_SAFE
+thread_local MCP23S17ApiStats *MCP23S17Instrument::current = nullptr;
+#else
+MCP23S17ApiStats *MCP23S17Instrument::current = nullptr;
+#endif
+
+MCP23S17ApiStats *MCP23S17Instrument::entry(const char *name){
+    MCP23S17ApiStats *api = &apis[0];
+    MCP_STATS_LOCK();
+    uint8_t i = 0;
+    while(i<numApis && strcmp(apis[i].name, name) != 0){
+        i++;
+    }
+    if(i < numApis){
+        api = &apis[i];
+    }
+    else if(numApis < MAX_APIS){
+        apis[numApis] = MCP23S17ApiStats{name, 0, 0, 0, 0, 0};
+        api = &apis[numApis++];
+    }
+    MCP_STATS_UNLOCK();
+    return api;
+}
+
+void MCP23S17Instrument::call(MCP23S17ApiStats *api){
+    MCP_STATS_LOCK();
+    api->calls++;
+    MCP_STATS_UNLOCK();
+}
+
+uint32_t MCP23S17Instrument::ticksPerUs(){
+#if defined(ARDUINO_ARCH_ESP32)
+    return ESP.getCpuFreqMHz();
+#elif defined(MYMCP23S17_HOST)
+    return 1000;
+#else
+    return 1;
+#endif
+}
+
+void MCP23S17Instrument::frame(uint8_t len, uint32_t ticks){
+    MCP23S17ApiStats *api = current ? current : &apis[0];
+    MCP_STATS_LOCK();
+    api->frames++;
+    api->bytes += len;
+    api->ticks += ticks;
+    MCP_STATS_UNLOCK();
+}
+
+void MCP23S17Instrument::transaction(){
+    MCP23S17ApiStats *api = current ? current : &apis[0];
+    MCP_STATS_LOCK();
+    api->transactions++;
+    MCP_STATS_UNLOCK();
+}
+
+void MCP23S17Instrument::reset(){
+    MCP_STATS_LOCK();
+    for(uint8_t i=0; i<numApis; i++){
+        apis[i] = MCP23S17ApiStats{apis[i].name, 0, 0, 0, 0, 0};
+    }
+    MCP_STATS_UNLOCK();
+}
+
+static void printColumn(Print &out, const char *text, uint8_t width){
+    uint8_t len = strlen(text);
+    out.print(text);
+    while(len++ < width){
+        out.print(' ');
+    }
+}
+
+static void printColumn(Print &out, unsigned long val, uint8_t width){
+    char buf[21];  // 2^64 - 1 has 20 digits
+    snprintf(buf, sizeof(buf), "%lu", val);
+    printColumn(out, buf, width);
+}
+
+void MCP23S17Instrument::dump(Print &out){
+    uint32_t perUs = ticksPerUs();
+    out.println("API                          calls     frames    bytes     trans     us        us/call");
+    for(uint8_t i=0; i<getNumApis(); i++){
+        MCP_STATS_LOCK();
+        const MCP23S17ApiStats a = apis[i];  // copied, printing is too slow for the lock
+        MCP_STATS_UNLOCK();
+        if(a.calls == 0 && a.frames == 0){
+            continue;
+        }
+        unsigned long us = a.ticks / perUs;
+        printColumn(out, a.name, 29);
+        printColumn(out, (unsigned long)a.calls, 10);
+        printColumn(out, (unsigned long)a.frames, 10);
+        printColumn(out, (unsigned long)a.bytes, 10);
+        printColumn(out, (unsigned long)a.transactions, 10);
+        printColumn(out, us, 10);
+        out.println(a.calls ? (double)a.ticks / perUs / a.calls : 0.0);
+    }
+}
+
+#endif
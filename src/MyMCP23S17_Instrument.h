@@ -0,0 +1,142 @@
+/*****************************************
+Instrumentation for MyMCP23S17_INSTRUMENT (see MyMCP23S17_config.h).
+
+Counts the SPI frames, bytes, transactions begun and the time spent in
+the transfers, per public function of the library. Each instrumented
+function opens an MCP_INSTRUMENT_API() scope (MCP_INSTRUMENT_NAMED() in
+the add-on classes, e.g. "Scanner::scan"); frames are booked to the
+outermost open scope, so the 3 reads and 5 writes of e.g.
+setInterruptOnDefValDevPin() show up under its name and not under
+write() / read(). Frames outside any scope (e.g. queued jobs of the
+sequencer) are booked to "(other)".
+
+Transactions are counted where they are begun: beginTransaction() or
+spi_device_acquire_bus() in startBatch() (also used by commit() and
+MCP23S17Bus) and in single frames sent with useTransaction.
+
+Time is measured in ticks: CPU cycles (ESP.getCycleCount()) on ESP32,
+nanoseconds of the simulated clock in host builds and microseconds
+elsewhere. Frames queued to the ESP-IDF driver are counted without time.
+
+With MyMCP23S17_THREAD_SAFE the table and the counters are guarded by a
+lock of their own (a spinlock on ESP32, a mutex in host builds), since
+devices on different buses book concurrently. getApi() returns the entry
+unguarded, read it while no other task uses the library.
+
+MCP23S17Instrument::dump() prints a table. Without MyMCP23S17_INSTRUMENT
+the macros are empty and nothing of this is compiled.
+
+*******************************************/
+
+#pragma once
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+#include "MyMCP23S17_config.h"
+
+#ifdef MyMCP23S17_INSTRUMENT
+
+struct MCP23S17ApiStats {
+    const char *name;
+    uint32_t calls;         // outermost calls
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t transactions;  // beginTransaction() / spi_device_acquire_bus() calls
+    uint64_t ticks;         // time spent in the transfers
+};
+
+class MCP23S17Instrument{
+
+    public:
+
+        static constexpr uint8_t MAX_APIS = 64;
+
+        /* The entry of a function, created on first use. Entries with the same name 
+         * (overloads) are merged. Returns the "(other)" entry if the table is full. */
+        static MCP23S17ApiStats *entry(const char *name);
+
+        static inline uint32_t ticks() {
+#if defined(ARDUINO_ARCH_ESP32)
+            return ESP.getCycleCount();
+#elif defined(MYMCP23S17_HOST)
+            return (uint32_t)hostNanos();
+#else
+            return micros();
+#endif
+        }
+
+        static uint32_t ticksPerUs();
+
+        /* book a frame / a begun transaction to the current scope */
+        static void frame(uint8_t len, uint32_t ticks);
+        static void transaction();
+
+        static uint8_t getNumApis() { return numApis; }
+        static const MCP23S17ApiStats &getApi(uint8_t idx) { return apis[idx]; }
+        static void reset();
+        /* prints one line per function with calls, frames, bytes, transactions, µs and µs per call */
+        static void dump(Print &out = Serial);
+
+    private:
+
+        friend class MCP23S17ApiScope;
+
+        static void call(MCP23S17ApiStats *api);
+
+        static MCP23S17ApiStats apis[MAX_APIS];
+        static uint8_t numApis;
+#ifdef MyMCP23S17_THREAD_SAFE
+        static thread_local MCP23S17ApiStats *current;
+#else
+        static MCP23S17ApiStats *current;
+#endif
+};
+
+/* Books all frames until the end of the scope to api, unless an outer scope is open */
+class MCP23S17ApiScope{
+
+    public:
+
+        explicit MCP23S17ApiScope(MCP23S17ApiStats *api) : outer{MCP23S17Instrument::current == nullptr} {
+            if(outer){
+                MCP23S17Instrument::current = api;
+                MCP23S17Instrument::call(api);
+            }
+        }
+
+        ~MCP23S17ApiScope() {
+            if(outer){
+                MCP23S17Instrument::current = nullptr;
+            }
+        }
+
+        MCP23S17ApiScope(const MCP23S17ApiScope &) = delete;
+        MCP23S17ApiScope &operator=(const MCP23S17ApiScope &) = delete;
+
+    private:
+
+        const bool outer;
+};
+
+#define MCP_INSTRUMENT_NAMED(name) \
+    static MCP23S17ApiStats *mcpApiStats = MCP23S17Instrument::entry(name); \
+    MCP23S17ApiScope mcpApiScope(mcpApiStats)
+#define MCP_INSTRUMENT_API() MCP_INSTRUMENT_NAMED(__func__)
+#define MCP_INSTRUMENT_START() uint32_t mcpStartTicks = MCP23S17Instrument::ticks()
+#define MCP_INSTRUMENT_FRAME(len) MCP23S17Instrument::frame(len, MCP23S17Instrument::ticks() - mcpStartTicks)
+#define MCP_INSTRUMENT_QUEUED(len) MCP23S17Instrument::frame(len, 0)
+#define MCP_INSTRUMENT_TRANSACTION() MCP23S17Instrument::transaction()
+
+#else
+
+#define MCP_INSTRUMENT_NAMED(name)
+#define MCP_INSTRUMENT_API()
+#define MCP_INSTRUMENT_START()
+#define MCP_INSTRUMENT_FRAME(len)
+#define MCP_INSTRUMENT_QUEUED(len)
+#define MCP_INSTRUMENT_TRANSACTION()
+
+#endif
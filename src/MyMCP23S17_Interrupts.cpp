@@ -0,0 +1,158 @@
+/*****************************************
+Interrupt engine for the MCP23S17, see MyMCP23S17_Interrupts.h
+
+*******************************************/
+
+#include "MyMCP23S17_Interrupts.h"
+
+#if !defined(ARDUINO_ARCH_ESP32) && !defined(MYMCP23S17_HOST)
+/* attachInterrupt() without argument: only one engine can be attached */
+static MCP23S17InterruptEngine *attachedEngine = nullptr;
+
+static void singleEngineIsr(){
+    if(attachedEngine){
+        attachedEngine->handleInterrupt();
+    }
+}
+#endif
+
+int8_t MCP23S17InterruptEngine::addDevice(MyMCP23S17 *dev){
+    if(numDevices >= MAX_DEVICES){
+        return -1;
+    }
+    devices[numDevices] = dev;
+    return numDevices++;
+}
+
+bool MCP23S17InterruptEngine::begin(uint8_t pin, int mode){
+    intPin = pin;
+    activeLevel = (mode == RISING) ? HIGH : LOW;
+    isrHead = isrTail = 0;
+    pinMode(intPin, INPUT);
+    clearInterrupts(); // an interrupt pending now would never cause an edge
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(MYMCP23S17_HOST)
+    attachInterruptArg(digitalPinToInterrupt(intPin), isrTrampoline, this, mode);
+#else
+    if(attachedEngine && attachedEngine != this){
+        return false;
+    }
+    attachedEngine = this;
+    attachInterrupt(digitalPinToInterrupt(intPin), singleEngineIsr, mode);
+#endif
+    return true;
+}
+
+void MCP23S17InterruptEngine::end(){
+    if(intPin == 0xFF){
+        return;
+    }
+    detachInterrupt(digitalPinToInterrupt(intPin));
+#if !defined(ARDUINO_ARCH_ESP32) && !defined(MYMCP23S17_HOST)
+    if(attachedEngine == this){
+        attachedEngine = nullptr;
+    }
+#endif
+    intPin = 0xFF;
+}
+
+bool MCP23S17InterruptEngine::onPins(uint8_t device, uint16_t pinMask, mcp_event_callback cb, void *arg){
+    if(numHandlers >= MAX_HANDLERS){
+        return false;
+    }
+    handlers[numHandlers++] = Handler{device, pinMask, cb, arg};
+    return true;
+}
+
+void IRAM_ATTR MCP23S17InterruptEngine::isrTrampoline(void *arg){
+    static_cast<MCP23S17InterruptEngine *>(arg)->handleInterrupt();
+}
+
+void IRAM_ATTR MCP23S17InterruptEngine::handleInterrupt(){
+    uint8_t head = isrHead;
+    uint8_t tail = __atomic_load_n(&isrTail, __ATOMIC_ACQUIRE);
+    if((uint8_t)(head - tail) >= ISR_QUEUE_SIZE){
+        isrOverflows = isrOverflows + 1;
+        return;
+    }
+    isrStamps[head & (ISR_QUEUE_SIZE - 1)] = micros();
+    __atomic_store_n(&isrHead, (uint8_t)(head + 1), __ATOMIC_RELEASE);
+}
+
+uint8_t MCP23S17InterruptEngine::service(){
+    MCP_INSTRUMENT_NAMED("InterruptEngine::service");
+    uint8_t numEvents = 0;
+    uint8_t tail = isrTail;
+
+    while(tail != __atomic_load_n(&isrHead, __ATOMIC_ACQUIRE)){
+        uint32_t timestamp = isrStamps[tail & (ISR_QUEUE_SIZE - 1)];
+        tail++;
+        __atomic_store_n(&isrTail, tail, __ATOMIC_RELEASE);
+        numEvents += serviceDevices(timestamp);
+    }
+
+    /* INT still asserted: a new interrupt came up while reading, its edge may be lost */
+    for(uint8_t i=0; i<4 && intAsserted(); i++){
+        numEvents += serviceDevices(micros());
+    }
+    return numEvents;
+}
+
+void MCP23S17InterruptEngine::clearInterrupts(){
+    MCP_INSTRUMENT_NAMED("InterruptEngine::clearInterrupts");
+    for(uint8_t i=0; i<numDevices; i++){
+        devices[i]->getIntCaps();
+    }
+}
+
+bool MCP23S17InterruptEngine::getEvent(MCP23S17Event &event){
+    if(eventHead == eventTail){
+        return false;
+    }
+    event = events[eventTail & (EVENT_QUEUE_SIZE - 1)];
+    eventTail++;
+    return true;
+}
+
+/* INTF and INTCAP are consecutive pairs (BANK=0: one frame, BANK=1: one per port), reading 
+ * INTCAP clears the interrupt */
+uint8_t MCP23S17InterruptEngine::serviceDevices(uint32_t timestamp){
+    uint8_t numEvents = 0;
+    for(uint8_t i=0; i<numDevices; i++){
+        uint16_t pairs[2] = {};
+        devices[i]->readRegPairs(MCP_INTF, MCP_INTCAP, pairs);
+        numEvents += decode(i, pairs[0], pairs[1], timestamp);
+    }
+    return numEvents;
+}
+
+uint8_t MCP23S17InterruptEngine::decode(uint8_t device, uint16_t intFlags, uint16_t intCaps, uint32_t timestamp){
+    uint8_t numEvents = 0;
+    while(intFlags){
+        uint8_t pin = __builtin_ctz(intFlags);
+        intFlags &= intFlags - 1;  // clear lowest set bit
+
+        MCP23S17Event event = {timestamp, device, pin, (uint8_t)((intCaps >> pin) & 1)};
+        pushEvent(event);
+        for(uint8_t h=0; h<numHandlers; h++){
+            if(handlers[h].device == device && (handlers[h].pinMask & (1U << pin))){
+                handlers[h].callback(event, handlers[h].arg);
+            }
+        }
+        numEvents++;
+    }
+    return numEvents;
+}
+
+bool MCP23S17InterruptEngine::intAsserted(){
+    return intPin != 0xFF && digitalRead(intPin) == activeLevel;
+}
+
+void MCP23S17InterruptEngine::pushEvent(const MCP23S17Event &event){
+    if((uint8_t)(eventHead - eventTail) >= EVENT_QUEUE_SIZE){
+        eventTail++;  // drop the oldest event
+        eventOverflows++;
+    }
+    events[eventHead & (EVENT_QUEUE_SIZE - 1)] = event;
+    eventHead++;
+}
@@ -0,0 +1,104 @@
+/*****************************************
+Interrupt engine for the MCP23S17.
+
+The host pin connected to INTA/INTB (or to several mirrored / open-drain
+INT outputs) is attached to an ISR which only stores a timestamp in a
+lock-free ring buffer. service(), called from loop() or a task, reads
+INTFA, INTFB, INTCAPA and INTCAPB of each registered device in one
+sequential frame (which also clears the interrupt), decodes the pins
+which caused it and hands out {device, pin, level, timestamp} events:
+to callbacks registered for these pins and to an event queue.
+
+Pins are numbered 0...15: 0...7 = GPA0...GPA7, 8...15 = GPB0...GPB7.
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+struct MCP23S17Event {
+    uint32_t timestamp;  // micros() in the ISR
+    uint8_t device;      // index of the device in the engine
+    uint8_t pin;         // 0...15
+    uint8_t level;       // captured level (INTCAP)
+};
+
+typedef void (*mcp_event_callback)(const MCP23S17Event &event, void *arg);
+
+class MCP23S17InterruptEngine{
+
+    public:
+
+        static constexpr uint8_t MAX_DEVICES = 8;
+        static constexpr uint8_t MAX_HANDLERS = 16;
+        static constexpr uint8_t ISR_QUEUE_SIZE = 16;    // power of 2
+        static constexpr uint8_t EVENT_QUEUE_SIZE = 32;  // power of 2
+
+        MCP23S17InterruptEngine() : devices{}, numDevices{0}, handlers{}, numHandlers{0}, intPin{0xFF},
+            activeLevel{LOW}, isrStamps{}, isrHead{0}, isrTail{0}, isrOverflows{0}, events{},
+            eventHead{0}, eventTail{0}, eventOverflows{0} {}
+
+        /* returns the index of the device or -1 if there is no space left */
+        int8_t addDevice(MyMCP23S17 *dev);
+
+        /* Attaches the ISR to intPin. mode: FALLING for active-low INT outputs (default,
+         * also open drain), RISING for active-high ones (setInterruptPinPol(HIGH)). */
+        bool begin(uint8_t pin, int mode = FALLING);
+        void end();
+
+        /* callback for the pins in pinMask (bit 0...15) of a device */
+        bool onPins(uint8_t device, uint16_t pinMask, mcp_event_callback cb, void *arg = nullptr);
+
+        /* ISR part, only to be called directly if the ISR is attached by the user */
+        void IRAM_ATTR handleInterrupt();
+
+        /* Worker part: services pending interrupts and returns the number of events */
+        uint8_t service();
+        /* Reads (and so clears) pending interrupts of all devices without creating events */
+        void clearInterrupts();
+
+        bool getEvent(MCP23S17Event &event);
+        uint8_t getNumEvents() const { return (uint8_t)(eventHead - eventTail); }
+        uint32_t getIsrOverflows() const { return isrOverflows; }
+        uint32_t getEventOverflows() const { return eventOverflows; }
+
+        /* decodes INTF/INTCAP of one device, used by service() */
+        uint8_t decode(uint8_t device, uint16_t intFlags, uint16_t intCaps, uint32_t timestamp);
+
+    protected:
+
+        struct Handler {
+            uint8_t device;
+            uint16_t pinMask;
+            mcp_event_callback callback;
+            void *arg;
+        };
+
+        static void IRAM_ATTR isrTrampoline(void *arg);
+        uint8_t serviceDevices(uint32_t timestamp);
+        bool intAsserted();
+        void pushEvent(const MCP23S17Event &event);
+
+        MyMCP23S17 *devices[MAX_DEVICES];
+        uint8_t numDevices;
+        Handler handlers[MAX_HANDLERS];
+        uint8_t numHandlers;
+        uint8_t intPin;
+        uint8_t activeLevel;
+
+        /* single producer (ISR) / single consumer (service()) ring buffer */
+        uint32_t isrStamps[ISR_QUEUE_SIZE];
+        volatile uint8_t isrHead;
+        volatile uint8_t isrTail;
+        volatile uint32_t isrOverflows;
+
+        MCP23S17Event events[EVENT_QUEUE_SIZE];
+        uint8_t eventHead;
+        uint8_t eventTail;
+        uint32_t eventOverflows;
+};
@@ -0,0 +1,85 @@
+/*****************************************
+Bus locking for MyMCP23S17_THREAD_SAFE, see MyMCP23S17_Lock.h
+
+*******************************************/
+
+#include "MyMCP23S17_config.h"
+
+#ifdef MyMCP23S17_THREAD_SAFE
+
+#include "MyMCP23S17_Lock.h"
+
+MCP23S17BusLock *MCP23S17BusLock::forBus(const void *bus){
+    static MCP23S17BusLock locks[MAX_BUSES];
+
+    for(uint8_t i=0; i<MAX_BUSES; i++){
+        if(locks[i].bus == bus){
+            return &locks[i];
+        }
+    }
+    for(uint8_t i=0; i<MAX_BUSES; i++){
+        if(locks[i].bus == nullptr){
+#if defined(ARDUINO_ARCH_ESP32)
+            locks[i].mutex = xSemaphoreCreateRecursiveMutex();
+            if(!locks[i].mutex){
+                return nullptr;
+            }
+#endif
+            locks[i].bus = bus;
+            return &locks[i];
+        }
+    }
+    return nullptr;
+}
+
+void MCP23S17BusLock::lock(){
+#if defined(ARDUINO_ARCH_ESP32)
+    if(xSemaphoreTakeRecursive(mutex, 0) != pdTRUE){
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        stats.contentions++;  // counted when owned, so it is not a race
+    }
+#elif defined(MYMCP23S17_HOST)
+    if(!mutex.try_lock()){
+        mutex.lock();
+        stats.contentions++;
+    }
+    owner = std::this_thread::get_id();
+#endif
+    if(depth++ == 0){
+        stats.acquisitions++;
+        holdStart = micros();
+    }
+}
+
+void MCP23S17BusLock::unlock(){
+    if(depth == 0 || !ownedByCaller()){
+        return;
+    }
+    if(--depth == 0){
+        uint32_t hold = micros() - holdStart;
+        stats.totalHoldUs += hold;
+        if(hold > stats.maxHoldUs){
+            stats.maxHoldUs = hold;
+        }
+    }
+#if defined(ARDUINO_ARCH_ESP32)
+    xSemaphoreGiveRecursive(mutex);
+#elif defined(MYMCP23S17_HOST)
+    if(depth == 0){
+        owner = std::thread::id();
+    }
+    mutex.unlock();
+#endif
+}
+
+bool MCP23S17BusLock::ownedByCaller(){
+#if defined(ARDUINO_ARCH_ESP32)
+    return xSemaphoreGetMutexHolder(mutex) == xTaskGetCurrentTaskHandle();
+#elif defined(MYMCP23S17_HOST)
+    return owner == std::this_thread::get_id();
+#else
+    return true;
+#endif
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*****************************************
+Bus locking for MyMCP23S17_THREAD_SAFE (see MyMCP23S17_config.h).
+
+All MyMCP23S17 objects on one SPIClass share one MCP23S17BusLock. It is
+a recursive mutex, so a task holding the bus (e.g. in a batch) can send
+further frames, and the owner is tracked: only the task which locked the
+bus can release it. The mutex is a FreeRTOS recursive mutex on ESP32 and
+a std::recursive_mutex in host builds; on targets without threads the
+lock only counts.
+
+The lock counts acquisitions, contentions (the bus was held by another
+task) and how long it was held, to size priorities and batch lengths.
+
+*******************************************/
+
+#pragma once
+
+#if ARDUINO < 100
+#include <WProgram.h>
+#else
+#include <Arduino.h>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#elif defined(MYMCP23S17_HOST)
+#include <mutex>
+#include <thread>
+#endif
+
+struct MCP23S17LockStats {
+    uint32_t acquisitions;  // outermost lock() calls
+    uint32_t contentions;   // lock() calls which had to wait
+    uint32_t maxHoldUs;
+    uint64_t totalHoldUs;
+};
+
+class MCP23S17BusLock{
+
+    public:
+
+        static constexpr uint8_t MAX_BUSES = 4;
+
+        /* The lock of a bus, created on first use. Call it (i.e. Init() the devices) from one
+         * task before the devices are shared. Returns nullptr if all MAX_BUSES are in use. */
+        static MCP23S17BusLock *forBus(const void *bus);
+
+        void lock();
+        /* ignored if the calling task does not hold the lock */
+        void unlock();
+
+        const MCP23S17LockStats &getStats() const { return stats; }
+        void resetStats() { stats = MCP23S17LockStats{}; }
+
+    protected:
+
+        MCP23S17BusLock() : bus{nullptr}, depth{0}, holdStart{0}, stats{} {}
+
+        const void *bus;
+        uint8_t depth;       // recursion depth of the owner
+        uint32_t holdStart;
+        MCP23S17LockStats stats;
+#if defined(ARDUINO_ARCH_ESP32)
+        SemaphoreHandle_t mutex = nullptr;
+#elif defined(MYMCP23S17_HOST)
+        std::recursive_mutex mutex;
+        std::thread::id owner;
+#endif
+
+        bool ownedByCaller();
+};
+
+/* Holds a bus lock for its scope, accepts nullptr */
+class MCP23S17LockGuard{
+
+    public:
+
+        explicit MCP23S17LockGuard(MCP23S17BusLock *l) : busLock{l} {
+            if(busLock){
+                busLock->lock();
+            }
+        }
+
+        ~MCP23S17LockGuard() {
+            if(busLock){
+                busLock->unlock();
+            }
+        }
+
+        MCP23S17LockGuard(const MCP23S17LockGuard &) = delete;
+        MCP23S17LockGuard &operator=(const MCP23S17LockGuard &) = delete;
+
+    private:
+
+        MCP23S17BusLock *busLock;
+};
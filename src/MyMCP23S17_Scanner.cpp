@@ -0,0 +1,148 @@
+/*****************************************
+Periodic input scanner for MCP23S17 devices, see MyMCP23S17_Scanner.h
+
+*******************************************/
+
+#include "MyMCP23S17_Scanner.h"
+
+int8_t MCP23S17Scanner::addDevice(MyMCP23S17 *dev){
+    if(numDevices >= MAX_DEVICES){
+        return -1;
+    }
+    devices[numDevices] = dev;
+    return numDevices++;
+}
+
+void MCP23S17Scanner::begin(){
+    nextDue = micros() + periodUs;
+    running = true;
+}
+
+bool MCP23S17Scanner::poll(){
+    if(!running){
+        begin();
+    }
+    if((int32_t)(micros() - nextDue) < 0){
+        return false;
+    }
+    scan();
+    return true;
+}
+
+void MCP23S17Scanner::scan(){
+    MCP_INSTRUMENT_NAMED("Scanner::scan");
+    uint32_t now = micros();
+    if(!running){
+        nextDue = now;
+        running = true;
+    }
+    updateTiming(now);
+
+    uint8_t idx = published ^ 1;
+    Buffer &buf = buffers[idx];
+    buf.seq = buf.seq + 1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    buf.data.sequence = stats.scans;
+    buf.data.timestamp = now;
+    for(uint8_t i=0; i<numDevices; i++){
+        buf.data.ports[i] = devices[i]->getPorts();
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    buf.seq = buf.seq + 1;
+    __atomic_store_n(&published, idx, __ATOMIC_RELEASE);
+
+    uint32_t duration = micros() - now;
+    if(duration > stats.maxScanUs){
+        stats.maxScanUs = duration;
+    }
+}
+
+/* Schedule: nextDue advances by whole periods, slots which are already over are skipped */
+void MCP23S17Scanner::updateTiming(uint32_t now){
+    int32_t lateness = (int32_t)(now - nextDue);
+    if(lateness > 0 && (uint32_t)lateness > stats.maxJitterUs){
+        stats.maxJitterUs = lateness;
+    }
+
+    if(stats.scans > 0){
+        uint32_t period = now - lastScan;
+        periodSum += period;
+        if(period < stats.minPeriodUs){
+            stats.minPeriodUs = period;
+        }
+        if(period > stats.maxPeriodUs){
+            stats.maxPeriodUs = period;
+        }
+        stats.avgPeriodUs = periodSum / stats.scans;
+    }
+    lastScan = now;
+    stats.scans++;
+
+    nextDue += periodUs;
+    if(periodUs > 0 && (int32_t)(now - nextDue) >= 0){
+        uint32_t missed = (now - nextDue) / periodUs + 1;
+        stats.overruns += missed;
+        nextDue += missed * periodUs;
+    }
+}
+
+bool MCP23S17Scanner::getSnapshot(MCP23S17Snapshot &snapshot) const {
+    while(true){
+        const Buffer &buf = buffers[__atomic_load_n(&published, __ATOMIC_ACQUIRE)];
+        uint32_t seq = buf.seq;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(seq == 0){
+            return false;  // no scan yet
+        }
+        if(seq & 1){
+            continue;
+        }
+        snapshot = buf.data;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(buf.seq == seq){
+            return true;
+        }
+    }
+}
+
+uint16_t MCP23S17Scanner::getPorts(uint8_t idx) const {
+    MCP23S17Snapshot snapshot;
+    if(idx >= numDevices || !getSnapshot(snapshot)){
+        return 0;
+    }
+    return snapshot.ports[idx];
+}
+
+void MCP23S17Scanner::resetStats(){
+    stats = MCP23S17ScanStats{};
+    stats.minPeriodUs = 0xFFFFFFFF;
+    periodSum = 0;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void MCP23S17Scanner::timerCallback(void *arg){
+    static_cast<MCP23S17Scanner *>(arg)->scan();
+}
+
+bool MCP23S17Scanner::startTimer(){
+    if(!timer){
+        esp_timer_create_args_t args = {};
+        args.callback = timerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "mcp23s17_scan";
+        if(esp_timer_create(&args, &timer) != ESP_OK){
+            return false;
+        }
+    }
+    begin();
+    return esp_timer_start_periodic(timer, periodUs) == ESP_OK;
+}
+
+void MCP23S17Scanner::stopTimer(){
+    if(timer){
+        esp_timer_stop(timer);
+        running = false;
+    }
+}
+#endif
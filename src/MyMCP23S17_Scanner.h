@@ -0,0 +1,104 @@
+/*****************************************
+Periodic input scanner for MCP23S17 devices.
+
+MCP23S17Scanner reads GPIOA/GPIOB of all registered devices (one frame
+per device) at a fixed period and publishes them as a snapshot. The
+schedule is absolute (start + n * period), so delays do not accumulate;
+lateness against the schedule is recorded as jitter, and slots which
+are missed completely are counted as overruns and skipped.
+
+The scans are triggered by:
+- poll(), called as often as possible from loop() or a task, it scans
+  when the next slot is due (all platforms, also the host simulator)
+- startTimer() on ESP32: an esp_timer calls scan() from the esp_timer
+  task, 1...10 kHz are possible
+
+Snapshots are double buffered, each buffer guarded by a sequence
+number (seqlock). getSnapshot() never blocks the scanner and retries
+only if the scanner overwrote the buffer during the copy.
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp_timer.h"
+#endif
+
+struct MCP23S17Snapshot {
+    static constexpr uint8_t MAX_DEVICES = 8;
+    uint32_t sequence;   // number of the scan
+    uint32_t timestamp;  // micros() at the start of the scan
+    uint16_t ports[MAX_DEVICES];  // port A = low byte, port B = high byte
+};
+
+struct MCP23S17ScanStats {
+    uint32_t scans;
+    uint32_t overruns;      // slots missed
+    uint32_t maxJitterUs;   // max. lateness against the schedule
+    uint32_t minPeriodUs;
+    uint32_t maxPeriodUs;
+    uint32_t avgPeriodUs;
+    uint32_t maxScanUs;     // max. duration of a scan
+};
+
+class MCP23S17Scanner{
+
+    public:
+
+        static constexpr uint8_t MAX_DEVICES = MCP23S17Snapshot::MAX_DEVICES;
+
+        MCP23S17Scanner(uint32_t periodUs = 1000) : devices{}, numDevices{0}, periodUs{periodUs},
+            nextDue{0}, lastScan{0}, periodSum{0}, running{false}, buffers{}, published{0}, stats{} {
+            resetStats();
+        }
+
+        /* returns the index of the device in the snapshot or -1 if there is no space left */
+        int8_t addDevice(MyMCP23S17 *dev);
+        void setPeriod(uint32_t us) { periodUs = us; }
+        uint32_t getPeriod() const { return periodUs; }
+
+        /* starts the schedule with the next slot one period from now */
+        void begin();
+        /* scans if the next slot is due, returns true if it scanned */
+        bool poll();
+        /* scans now, the lateness against the schedule is taken as jitter */
+        void scan();
+
+#ifdef ARDUINO_ARCH_ESP32
+        bool startTimer();
+        void stopTimer();
+#endif
+
+        /* lock free copy of the latest scan, false if there was no scan yet */
+        bool getSnapshot(MCP23S17Snapshot &snapshot) const;
+        uint16_t getPorts(uint8_t idx) const;
+
+        const MCP23S17ScanStats &getStats() const { return stats; }
+        void resetStats();
+
+    protected:
+
+        struct Buffer {
+            volatile uint32_t seq;  // odd while being written
+            MCP23S17Snapshot data;
+        };
+
+        void updateTiming(uint32_t now);
+
+        MyMCP23S17 *devices[MAX_DEVICES];
+        uint8_t numDevices;
+        uint32_t periodUs;
+        uint32_t nextDue;
+        uint32_t lastScan;
+        uint64_t periodSum;
+        bool running;
+        Buffer buffers[2];
+        volatile uint8_t published;
+        MCP23S17ScanStats stats;
+#ifdef ARDUINO_ARCH_ESP32
+        esp_timer_handle_t timer = nullptr;
+        static void timerCallback(void *arg);
+#endif
+};
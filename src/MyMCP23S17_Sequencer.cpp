@@ -0,0 +1,176 @@
+/*****************************************
+Pattern sequencer for the MCP23S17, see MyMCP23S17_Sequencer.h
+
+*******************************************/
+
+#include "MyMCP23S17.h"
+#ifndef MyMCP23S17_BANK1   // the sequencer needs IOCON.BANK=0, see MyMCP23S17_Sequencer.h
+#include "MyMCP23S17_Sequencer.h"
+
+bool MCP23S17Sequencer::play(const uint16_t *states, uint16_t count, mcp_seq_mode m, const uint32_t *delaysUs){
+    if(!states || count == 0){
+        return false;
+    }
+    running = false;
+    prepareJobs();
+    cur = Buffer{states, delaysUs, count};
+    nextReady = false;
+    mode = m;
+    pos = 0;
+    starved = false;
+    nextDue = micros();
+    running = true;
+    return true;
+}
+
+bool MCP23S17Sequencer::queue(const uint16_t *states, uint16_t count, const uint32_t *delaysUs){
+    if(!states || count == 0 || nextReady){
+        return false;
+    }
+    next = Buffer{states, delaysUs, count};
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    nextReady = true;
+    return true;
+}
+
+void MCP23S17Sequencer::stop(){
+    running = false;
+    _dev->finishAsync();
+}
+
+bool MCP23S17Sequencer::poll(){
+    if(!running){
+        return false;
+    }
+    uint32_t now = micros();
+    int32_t lateness = (int32_t)(now - nextDue);
+    if(lateness < 0){
+        return false;
+    }
+    if((uint32_t)lateness > stats.maxLatenessUs){
+        stats.maxLatenessUs = lateness;
+    }
+    step();
+    if(running && (int32_t)(now - nextDue) >= 0){  // a whole slot behind: resync, no burst
+        stats.lateSteps++;
+        nextDue = now;
+    }
+    return true;
+}
+
+/* The port bytes are written into the pre-encoded frame of the next free job */
+void MCP23S17Sequencer::step(){
+    MCP_INSTRUMENT_NAMED("Sequencer::step");
+    if(!running){
+        return;
+    }
+    if(starved){
+        if(!nextReady){
+            nextDue += periodUs;  // hold the last state
+            return;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        cur = next;
+        nextReady = false;
+        pos = 0;
+        starved = false;
+    }
+
+    MCP23S17Job &job = jobs[jobIdx];
+    if(!job.isDone()){
+        _dev->pollAsync();
+    }
+    if(!job.isDone()){
+        /* the previous frame of this job is still in flight: the slot is held, the state 
+         * goes out with the next one */
+        stats.busyJobs++;
+        stats.underruns++;
+        nextDue += periodUs;
+        return;
+    }
+    uint16_t state = cur.states[pos];
+    {
+        /* mirror and frame in the same order as the frames of other tasks */
+        MCP_BUS_GUARD(_dev->busLock);
+        _dev->updatePair(MCP_GPIO, 0xFFFF, state);
+        job.tx[2] = state & 0xFF;
+        job.tx[3] = state >> 8;
+        _dev->submitAsync(job);
+    }
+    jobIdx = (jobIdx + 1) % NUM_JOBS;
+    stats.steps++;
+    nextDue += stepDelay();
+    advance();
+}
+
+bool MCP23S17Sequencer::advance(){
+    if(++pos < cur.count){
+        return true;
+    }
+    if(nextReady){
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        cur = next;
+        nextReady = false;
+        pos = 0;
+        return true;
+    }
+    switch(mode){
+        case MCP_SEQ_LOOP:
+            pos = 0;
+            return true;
+        case MCP_SEQ_STREAM:
+            stats.underruns++;
+            starved = true;
+            return false;
+        default:
+            running = false;
+            return false;
+    }
+}
+
+uint32_t MCP23S17Sequencer::stepDelay() const {
+    return cur.delaysUs ? cur.delaysUs[pos] : periodUs;
+}
+
+void MCP23S17Sequencer::prepareJobs(){
+    const uint8_t vals[2] = {0, 0};
+    for(uint8_t i=0; i<NUM_JOBS; i++){
+        jobs[i].wait();
+        _dev->prepareWrite(jobs[i], MyMCP23S17::GPIOA, vals, sizeof(vals));
+    }
+    jobIdx = 0;
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+void MCP23S17Sequencer::timerCallback(void *arg){
+    MCP23S17Sequencer *seq = static_cast<MCP23S17Sequencer *>(arg);
+    seq->poll();
+    if(seq->running){
+        int32_t wait = (int32_t)(seq->nextDue - micros());
+        esp_timer_start_once(seq->timer, wait > 0 ? wait : 0);
+    }
+}
+
+/* call after play(), the timer follows the schedule of the steps */
+bool MCP23S17Sequencer::startTimer(){
+    if(!timer){
+        esp_timer_create_args_t args = {};
+        args.callback = timerCallback;
+        args.arg = this;
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "mcp23s17_seq";
+        if(esp_timer_create(&args, &timer) != ESP_OK){
+            return false;
+        }
+    }
+    return esp_timer_start_once(timer, 0) == ESP_OK;
+}
+
+void MCP23S17Sequencer::stopTimer(){
+    if(timer){
+        esp_timer_stop(timer);
+    }
+}
+#endif
+
+#endif // MyMCP23S17_BANK1
@@ -0,0 +1,112 @@
+/*****************************************
+Pattern sequencer for the MCP23S17.
+
+MCP23S17Sequencer streams a buffer of 16 bit port states (port A = low
+byte, port B = high byte) to GPIOA/GPIOB, one state per step. Steps
+follow a fixed period or a delay per step, on an absolute schedule.
+
+Each step is one 4 byte frame. The frames are encoded once in a ring of
+MCP23S17Jobs, a step only writes the two port bytes and submits the job:
+with an ESP-IDF device (ESP32) it is queued to the driver and sent by
+DMA, otherwise it is sent immediately.
+
+Modes:
+- MCP_SEQ_ONCE:   plays the buffer once and stops
+- MCP_SEQ_LOOP:   repeats the buffer until stop() or until a queued
+                  buffer takes over at the end of a pass
+- MCP_SEQ_STREAM: double buffering, queue() the next buffer while the
+                  current one plays. If the end is reached without a
+                  queued buffer, that is an underrun: the last state is
+                  held and the stream continues with the next queue().
+
+If the job of a step still has its previous frame in flight, the slot is
+held as well (counted in underruns and busyJobs), no state is skipped.
+
+Steps are triggered by poll() (all platforms, also the host simulator)
+or, on ESP32, by an esp_timer with startTimer().
+
+*******************************************/
+
+#pragma once
+
+#include "MyMCP23S17.h"
+#ifdef MyMCP23S17_BANK1
+#error "MCP23S17Sequencer writes GPIOA and GPIOB in one frame, it needs IOCON.BANK=0"
+#endif
+#ifdef ARDUINO_ARCH_ESP32
+#include "esp_timer.h"
+#endif
+
+typedef enum MCP_SEQ_MODE {MCP_SEQ_ONCE, MCP_SEQ_LOOP, MCP_SEQ_STREAM} mcp_seq_mode;
+
+struct MCP23S17SeqStats {
+    uint32_t steps;
+    uint32_t underruns;     // slots without a new state: end of a stream without a queued buffer, busy job
+    uint32_t lateSteps;     // steps which missed their slot
+    uint32_t maxLatenessUs;
+    uint32_t busyJobs;      // slots held because the previous frame of the job was not sent yet
+};
+
+class MCP23S17Sequencer{
+
+    public:
+
+        static constexpr uint8_t NUM_JOBS = 4;  // frames in flight
+
+        MCP23S17Sequencer(MyMCP23S17 *dev, uint32_t periodUs = 1000) : _dev{dev}, jobs{}, jobIdx{0},
+            periodUs{periodUs}, mode{MCP_SEQ_ONCE}, running{false}, starved{false}, nextDue{0},
+            cur{}, next{}, nextReady{false}, pos{0}, stats{} {}
+
+        void setPeriod(uint32_t us) { periodUs = us; }
+
+        /* starts playing states[0...count-1]. delaysUs (optional): time from step i to step i+1 */
+        bool play(const uint16_t *states, uint16_t count, mcp_seq_mode m = MCP_SEQ_ONCE, const uint32_t *delaysUs = nullptr);
+        /* next buffer, taken over at the end of the current one (MCP_SEQ_LOOP / MCP_SEQ_STREAM) */
+        bool queue(const uint16_t *states, uint16_t count, const uint32_t *delaysUs = nullptr);
+        bool isQueueFree() const { return !nextReady; }
+        void stop();
+        bool isRunning() const { return running; }
+
+        /* outputs the next state if its step is due, returns true if it did */
+        bool poll();
+        /* outputs the next state now */
+        void step();
+
+#ifdef ARDUINO_ARCH_ESP32
+        bool startTimer();
+        void stopTimer();
+#endif
+
+        const MCP23S17SeqStats &getStats() const { return stats; }
+        void resetStats() { stats = MCP23S17SeqStats{}; }
+
+    protected:
+
+        struct Buffer {
+            const uint16_t *states;
+            const uint32_t *delaysUs;
+            uint16_t count;
+        };
+
+        void prepareJobs();
+        bool advance();
+        uint32_t stepDelay() const;
+
+        MyMCP23S17 *_dev;
+        MCP23S17Job jobs[NUM_JOBS];
+        uint8_t jobIdx;
+        uint32_t periodUs;
+        mcp_seq_mode mode;
+        volatile bool running;
+        bool starved;
+        uint32_t nextDue;
+        Buffer cur;
+        Buffer next;
+        volatile bool nextReady;
+        uint16_t pos;
+        MCP23S17SeqStats stats;
+#ifdef ARDUINO_ARCH_ESP32
+        esp_timer_handle_t timer = nullptr;
+        static void timerCallback(void *arg);
+#endif
+};
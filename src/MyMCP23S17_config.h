@@ -1,9 +1,32 @@
 
 #pragma once
 
+/* CS by writing the GPIO set/clear registers of the ESP32 instead of digitalWrite() */
+#if defined(ARDUINO_ARCH_ESP32) || defined(MYMCP23S17_HOST)
 #define MyMCP23S17_USE_ESP32_REG_WRITE
+#endif
 
+/* ESP-IDF SPI master driver (hardware CS, asynchronous DMA transfers), detected automatically. 
+ * The backend is chosen at runtime, see MyMCP23S17::beginIdfDevice(). */
+#if defined(ARDUINO_ARCH_ESP32)
+#define MyMCP23S17_HAS_IDF_SPI
+#endif
+
+/* Arduino SPIClass hardware CS (setHwCs()), only works for the SS pin of the SPI interface */
 // #define MyMCP23S17_USE_HW_CS
 
+/* Concurrent use from several tasks / cores (ESP32 FreeRTOS, host threads): SPI frames are 
+ * serialized by a lock per SPIClass and bit changes of the register mirror are atomic. */
+// #define MyMCP23S17_THREAD_SAFE
+
+/* Counts SPI frames, bytes, transactions and transfer time per public function, 
+ * see MyMCP23S17_Instrument.h. Without it the counting compiles to nothing. */
+// #define MyMCP23S17_INSTRUMENT
+
+/* Register layout IOCON.BANK=1 (one register block per port) instead of BANK=0 (A/B pairs 
+ * interleaved). Init() switches the device. A pair is then written in two frames, so the 
+ * sequencer and setPortsAsync() / getPortsAsync() are not available. */
+// #define MyMCP23S17_BANK1
+
 /* Uncomment the following line to be able to use printAllRegisters() */
 #define DEBUG_MyMCP23S17 
\ No newline at end of file